@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace spezi
+{
+    // Searches a fixed set of positions to a fixed depth, each with a cleared transposition table,
+    // the opening book off and the default options otherwise. Reports nodes and time of the whole
+    // search (all depths) per position and in total; the total number of nodes is a signature of
+    // the search: it changes only if the search itself does.
+    int64_t bench(int depth, unsigned int hashMegaBytes, std::function<void(std::string)> outputFunction);
+}
@@ -126,12 +126,14 @@ namespace spezi
     BitBoard constexpr EDGES = A1|A2|A3|A4|A5|A6|A7|A8|B8|C8|D8|E8|F8|G8|H8|H7|H6|H5|H4|H3|H2|H1|G1|F1|E1|D1|C1|B1;
     BitBoard constexpr INNER = ~EDGES;
 
-    static inline BitBoard pdep(BitBoard const source, BitBoard const mask)
+    // BMI2 only: compiled for BMI2 even without -mbmi2, callers have to check the CPU
+    // (see SliderAttacks in BitBoardArray.hpp)
+    __attribute__((target("bmi2"))) static inline BitBoard pdep(BitBoard const source, BitBoard const mask)
     {
         return _pdep_u64(source, mask);
     }
     
-    static inline BitBoard pext(BitBoard const source, BitBoard const mask)
+    __attribute__((target("bmi2"))) static inline BitBoard pext(BitBoard const source, BitBoard const mask)
     {
         return _pext_u64(source, mask);
     }
@@ -4,9 +4,12 @@
 #include "Color.hpp"
 #include "Square.hpp"
 
+#include <stdexcept>
+
 #include "BitBoardArrayDetail.hpp"
 
 #include <array>
+#include <string>
 
 namespace spezi
 { 
@@ -17,13 +20,28 @@ namespace spezi
     BitBoardArray constexpr RanksAndFiles = detail::collectBitBoards(detail::rankAndFile);
     BitBoardArray constexpr Diagonals = detail::collectBitBoards(detail::diagonals);
 
+    // Between[a][b]: squares strictly between a and b, Line[a][b]: the whole line through a and b
+    // (both empty if a and b do not share a rank, file or diagonal)
+    auto constexpr Between = detail::collectSquarePairs(detail::between);
+    auto constexpr Line = detail::collectSquarePairs(detail::line);
+
     BitBoardArray constexpr KingAttacks = detail::collectBitBoards(detail::kingAttack);
-    auto constexpr RankAttacks = detail::collectBitBoards<detail::rankAttack>();
-    auto constexpr RankMasks = detail::collectBitBoards(detail::rankMask);
-    auto constexpr FileAttacks = detail::collectBitBoards<detail::fileAttack>();
-    auto constexpr FileMasks = detail::collectBitBoards(detail::fileMask);
-    auto constexpr DiagonalAttacks = detail::collectBitBoards<detail::diagonalAttack>();    
-    auto constexpr DiagonalMasks = detail::collectBitBoards(detail::diagonalMask);
+    // sliding attacks: one pext and one lookup per rook or bishop
+    // (102400 rook and 5248 bishop entries)
+    BitBoardArray constexpr RookMasks = detail::collectBitBoards(detail::rookMask);
+    auto constexpr RookOffsets = detail::collectOffsets(detail::rookMask);
+    auto constexpr RookAttacks = detail::collectPackedAttacks<detail::rookMask>(Neighborhood::RookReachable);
+    BitBoardArray constexpr BishopMasks = detail::collectBitBoards(detail::diagonalMask);
+    auto constexpr BishopOffsets = detail::collectOffsets(detail::diagonalMask);
+    auto constexpr BishopAttacks = detail::collectPackedAttacks<detail::diagonalMask>(Neighborhood::BishopReachable);
+
+    // the same attacks indexed by magic multiplication instead of pext (same offsets)
+    auto constexpr RookShifts = detail::collectShifts(detail::rookMask);
+    auto constexpr RookMagicAttacks = 
+        detail::collectMagicAttacks<detail::rookMask>(detail::RookMagics, RookAttacks);
+    auto constexpr BishopShifts = detail::collectShifts(detail::diagonalMask);
+    auto constexpr BishopMagicAttacks = 
+        detail::collectMagicAttacks<detail::diagonalMask>(detail::BishopMagics, BishopAttacks);
     BitBoardArray constexpr KnightAttacks = detail::collectBitBoards(detail::knightAttack);
     BitBoardArray constexpr PawnAttacks[NumberOfColors] =
     {
@@ -35,4 +53,86 @@ namespace spezi
         detail::collectBitBoards(detail::pawnPush<WHITE>),
         detail::collectBitBoards(detail::pawnPush<BLACK>)
     };
+
+    // How the sliding attacks are looked up. pext needs BMI2 and is microcoded (slow) on
+    // AMD Zen 1 and Zen 2, magic multiplication runs anywhere at about the same speed,
+    // the portable lookup uses a software pext and serves as reference.
+    enum SliderAttacks
+    {
+        PEXT_ATTACKS,
+        MAGIC_ATTACKS,
+        PORTABLE_ATTACKS
+    };
+
+    inline SliderAttacks detectSliderAttacks()
+    {
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("bmi2") && !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2"))
+        {
+            return PEXT_ATTACKS;
+        }
+        return MAGIC_ATTACKS;
+    }
+
+    // detected at startup (before main) and changed by the UCI option SliderAttacks only,
+    // the lookups below branch on it, there are no indirect calls
+    inline SliderAttacks sliderAttacks = detectSliderAttacks();
+
+    static inline SliderAttacks parseSliderAttacks(std::string const & name)
+    {
+        if(name == "auto")
+        {
+            return detectSliderAttacks();
+        }
+        else if(name == "pext")
+        {
+            if(!__builtin_cpu_supports("bmi2"))
+            {
+                throw std::runtime_error("pext slider attacks need a CPU with BMI2");
+            }
+            return PEXT_ATTACKS;
+        }
+        else if(name == "magic")
+        {
+            return MAGIC_ATTACKS;
+        }
+        else if(name == "portable")
+        {
+            return PORTABLE_ATTACKS;
+        }
+        throw std::runtime_error("unknown slider attacks " + name);
+    }
+
+    static inline char const * sliderAttacksName(SliderAttacks const attacks)
+    {
+        return attacks == PEXT_ATTACKS ? "pext" : attacks == MAGIC_ATTACKS ? "magic" : "portable";
+    }
+
+    static inline BitBoard rookAttacks(Square const square, BitBoard const occupied)
+    {
+        if(sliderAttacks == PEXT_ATTACKS)
+        {
+            return RookAttacks[RookOffsets[square] + pext(occupied, RookMasks[square])];
+        }
+        else if(sliderAttacks == MAGIC_ATTACKS)
+        {
+            return RookMagicAttacks[RookOffsets[square] 
+                + ((occupied & RookMasks[square]) * detail::RookMagics[square] >> RookShifts[square])];
+        }
+        return RookAttacks[RookOffsets[square] + detail::pext_slow(occupied, RookMasks[square])];
+    }
+
+    static inline BitBoard bishopAttacks(Square const square, BitBoard const occupied)
+    {
+        if(sliderAttacks == PEXT_ATTACKS)
+        {
+            return BishopAttacks[BishopOffsets[square] + pext(occupied, BishopMasks[square])];
+        }
+        else if(sliderAttacks == MAGIC_ATTACKS)
+        {
+            return BishopMagicAttacks[BishopOffsets[square] 
+                + ((occupied & BishopMasks[square]) * detail::BishopMagics[square] >> BishopShifts[square])];
+        }
+        return BishopAttacks[BishopOffsets[square] + detail::pext_slow(occupied, BishopMasks[square])];
+    }
 }
@@ -64,6 +64,21 @@ namespace spezi::detail
         return result;
     }
 
+    // software pext for CPUs without BMI2
+    BitBoard constexpr pext_slow(BitBoard const source, BitBoard mask)
+    {
+        BitBoard result = 0;
+
+        for(BitBoard bit = 1; mask; bit <<= 1)
+        {
+            if(source & mask & -mask)
+            result |= bit;
+            mask &= mask - 1;
+        }
+
+        return result;
+    }
+
     BitBoard constexpr rankMask(Square const square)
     {               
         return (rank(square) & ~FILES[0] & ~FILES[SquaresPerRank-1]) & ~SQUARES[square];
@@ -125,6 +140,11 @@ namespace spezi::detail
                 | slidingAttack<NW>(diagonalMask, square, permutation);
     }
 
+    BitBoard constexpr rookMask(Square const square)
+    {
+        return rankMask(square) | fileMask(square);
+    }
+
     BitBoard constexpr knightAttack(Square const square)
     {
         auto result = EMPTY;
@@ -185,6 +205,34 @@ namespace spezi::detail
         }
     }
 
+    // squares strictly between two squares on a common rank, file or diagonal (empty otherwise)
+    BitBoard constexpr between(Square const from, Square const to)
+    {
+        for(auto const direction : KingQueenReachable)
+        {
+            auto const beyondFrom = ray(Neighbors[from][direction], direction);
+            if(beyondFrom & SQUARES[to])
+            {
+                return beyondFrom & ~ray(to, direction);
+            }
+        }
+        return EMPTY;
+    }
+
+    // complete rank, file or diagonal through two different squares (empty otherwise)
+    BitBoard constexpr line(Square const from, Square const to)
+    {
+        for(auto const direction : KingQueenReachable)
+        {
+            if(ray(Neighbors[from][direction], direction) & SQUARES[to])
+            {
+                auto const opposite = static_cast<Direction>((direction + NumberOfDirections / 2) % NumberOfDirections);
+                return ray(from, direction) | ray(Neighbors[from][opposite], opposite);
+            }
+        }
+        return EMPTY;
+    }
+
     // from here on, collect BitBoards of individual squares into arrays
     auto constexpr collectBitBoards(BitBoard bitBoardGenerator(Square))
     {
@@ -196,6 +244,164 @@ namespace spezi::detail
         return result;
     }
 
+    auto constexpr collectSquarePairs(BitBoard bitBoardGenerator(Square, Square))
+    {
+        auto result = std::array<std::array<BitBoard, NumberOfSquares>, NumberOfSquares>{};
+        for(Square s = 0; s < NumberOfSquares; ++s)
+        {
+            for(Square t = 0; t < NumberOfSquares; ++t)
+            {
+                result[s][t] = bitBoardGenerator(s, t);
+            }
+        }
+        return result;
+    }
+
+    // "fancy pext" tables: the attacks of all squares packed into one array, square s owning
+    // the 2^popcount(mask(s)) entries from offset s on, indexed by pext(occupied, mask(s))
+    auto constexpr collectOffsets(BitBoard maskGenerator(Square))
+    {
+        auto result = std::array<unsigned int, NumberOfSquares + 1> {};
+        for(Square s = 0; s < NumberOfSquares; ++s)
+        {
+            result[s + 1] = result[s] + (1u << popcount(maskGenerator(s)));
+        }
+        return result;
+    }
+
+    // the rays of a square are computed once, the attack of each subset along a ray is the ray
+    // up to and including the first blocker: the nearest one, the lowest square of the blockers
+    // on rays towards higher squares and the highest one otherwise
+    template<BitBoard maskGenerator(Square)>
+    auto constexpr collectPackedAttacks(Direction const (& directions)[4])
+    {
+        auto constexpr offsets = collectOffsets(maskGenerator);
+        auto result = std::array<BitBoard, offsets[NumberOfSquares]> {};
+
+        for(Square s = 0; s < NumberOfSquares; ++s)
+        {
+            auto const origin = SQUARES[s];
+            BitBoard rays[4] {};
+            for(auto i = 0; i < 4; ++i)
+            {
+                rays[i] = ray(Neighbors[s][directions[i]], directions[i]);
+            }
+
+            // the subsets of the mask in ascending order are pdep(0), pdep(1), ... of the mask
+            auto const mask = maskGenerator(s);
+            auto occupied = EMPTY;
+            auto index = offsets[s];
+            do
+            {
+                auto attack = EMPTY;
+                for(auto const squares : rays)
+                {
+                    auto const blockers = squares & occupied;
+                    if(!blockers)
+                    {
+                        attack |= squares;
+                    }
+                    else if(squares > origin)
+                    {
+                        attack |= squares & (2 * (blockers & -blockers) - 1);
+                    }
+                    else
+                    {
+                        attack |= squares & -(BitBoard {1} << (NumberOfSquares - 1 - __builtin_clzll(blockers)));
+                    }
+                }
+                result[index++] = attack;
+                occupied = (occupied - mask) & mask;
+            }
+            while(occupied);
+        }
+        return result;
+    }
+
+    // "fancy magics": index = (occupied & mask) * magic >> (64 - popcount(mask)), with the same
+    // number of index bits per square as pext, so the magic tables share the pext offsets.
+    // Found by trial with sparse random numbers (std::mt19937_64, seed 12345, x & y & z).
+    std::array<BitBoard, NumberOfSquares> constexpr RookMagics =
+    {
+        0x8080102040008000, 0x5440041000200048, 0x008020008010000A, 0x0200084200100420,
+        0x0200081020040200, 0x0600019002002824, 0x040050811008020C, 0x0100004881000126,
+        0x0005800440008020, 0x2882002042090880, 0x0002802000801004, 0x0240808010000800,
+        0x4480800800040082, 0x0408808004000200, 0x00BA0004A8020001, 0x1106000042040091,
+        0x0020208010400080, 0x0022060045028020, 0x0020008020100080, 0x0202020008102041,
+        0x0C50808008000400, 0x0068808002000400, 0x00510400C8100201, 0x400006000100A444,
+        0x483424818008400A, 0x8840008080200040, 0x0800100080802000, 0x0440100080800800,
+        0x4000080080040080, 0x9124040080020080, 0x0089000300040E00, 0x080001020020488C,
+        0x9040002040800080, 0x80D0002001400242, 0x0000401901002002, 0x0030220901001000,
+        0x0080580005003100, 0x0022006C0A001008, 0x0802301144001248, 0x0020010042000084,
+        0x4AC0400084228004, 0x0010004020004000, 0x3110004020010100, 0x0598100009050020,
+        0x4200080011010004, 0x0818020004008080, 0x02A0708102040008, 0x5201010080420004,
+        0x100B124063800100, 0x7808200240048980, 0x8800200010008080, 0x1099201001000900,
+        0x0100050010080100, 0x0400800200040080, 0x2040280190020400, 0x00100C0100608200,
+        0x0000201241088202, 0x1040002042801B01, 0x0124090010200041, 0x0831002004081001,
+        0x2003000800021005, 0x80010002040008C1, 0x0208008122081004, 0x4000008844002102
+    };
+
+    std::array<BitBoard, NumberOfSquares> constexpr BishopMagics =
+    {
+        0x04C4380860440140, 0x002002020A0C2000, 0x8021021400402002, 0x8004242280404200,
+        0x0804030800108200, 0x2001040240080080, 0x0001040104400808, 0x0084808800900444,
+        0x1200100411980200, 0x0000B01080908480, 0x0005088081020090, 0x1091041C21828802,
+        0x0004020210240020, 0x3081011002101580, 0x1500408824100408, 0x2420020100880540,
+        0x0860904002840122, 0x8022003110021082, 0x2042001004001820, 0x4A0800A402102440,
+        0x0884000A00940008, 0x0912006022100200, 0x0411044200822000, 0x0002012101092100,
+        0x00A0840808080800, 0x0204022004080801, 0x1118020001020200, 0x0022008028008002,
+        0x2001001021004000, 0x4000820181004216, 0x00209122008C1000, 0x00C04206A0808400,
+        0x0A01082000082001, 0x0449043088421004, 0x2000180600240C00, 0x000B200800030811,
+        0x80840040101C0100, 0x8012080600204040, 0x0808880040010100, 0x0018309282010040,
+        0x0428040484066080, 0x6202085404500200, 0x2400824240420800, 0x820400D148003400,
+        0x4240200410404C00, 0x081116180A010040, 0x0C60084604A00040, 0x028102020A000049,
+        0x400480842021C040, 0x0002020124421984, 0x4100410088041048, 0x0040800084040400,
+        0x8200011002020416, 0x05480810010A0A11, 0x0010101148428000, 0xA002840802004040,
+        0x0002020622020210, 0x0000228048280401, 0x0102500044041122, 0x4421100400420880,
+        0x2803001C04104414, 0x0002453012108104, 0x0210C00508120441, 0x3040010400820040
+    };
+
+    auto constexpr collectShifts(BitBoard maskGenerator(Square))
+    {
+        auto result = std::array<unsigned char, NumberOfSquares> {};
+        for(Square s = 0; s < NumberOfSquares; ++s)
+        {
+            result[s] = 64 - popcount(maskGenerator(s));
+        }
+        return result;
+    }
+
+    // the attacks of the pext table rearranged by magic index: copied, not generated again
+    template<BitBoard maskGenerator(Square), std::size_t size>
+    auto constexpr collectMagicAttacks(std::array<BitBoard, NumberOfSquares> const & magics,
+        std::array<BitBoard, size> const & attacks)
+    {
+        auto constexpr offsets = collectOffsets(maskGenerator);
+        auto result = std::array<BitBoard, size> {};
+
+        for(Square s = 0; s < NumberOfSquares; ++s)
+        {
+            auto const mask = maskGenerator(s);
+            auto const shift = 64 - popcount(mask);
+            auto occupied = EMPTY;
+            auto index = offsets[s];
+            do
+            {
+                auto const attack = attacks[index++];
+                auto & entry = result[offsets[s] + (occupied * magics[s] >> shift)];
+                // attacks are never empty, so an empty entry is unused
+                if(entry != EMPTY && entry != attack)
+                {
+                    throw std::runtime_error("magic number collision");
+                }
+                entry = attack;
+                occupied = (occupied - mask) & mask;
+            }
+            while(occupied);
+        }
+        return result;
+    }
+
     template<BitBoard bitBoardGenerator(Square, BitBoard)>
     auto constexpr collectBitBoards()
     {
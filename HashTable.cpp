@@ -17,47 +17,6 @@ namespace spezi
             }
             return result;
         }
-
-        char constexpr p[] = " NBRQK";
-        char constexpr f[] = "abcdefgh";
-        char constexpr r[] = "12345678";
-        char constexpr x[] = "xxxxx-";
-        char constexpr PR[] = " NBRQ ";
-        char constexpr pr[] = " nbrq ";
-    }
-
-    std::string HashEntry::getUciNotation() const
-    {    
-        auto const result = std::string{}
-            + f[value<Square, ORIGIN_SQUARE_MASK>() % SquaresPerRank]
-            + r[value<Square, ORIGIN_SQUARE_MASK>() / SquaresPerRank]
-            + f[value<Square, TARGET_SQUARE_MASK>() % SquaresPerRank]
-            + r[value<Square, TARGET_SQUARE_MASK>() / SquaresPerRank]
-            + pr[value<Piece, PROMOTED_PIECE_MASK>()];
-   
-        return result;
-    }
-
-    std::string HashEntry::getLongAlgebraicNotation() const
-    {    
-        auto const result = std::string(1, p[value<Piece, MOVED_PIECE_MASK>()])
-            + f[value<Square, ORIGIN_SQUARE_MASK>() % SquaresPerRank]
-            + r[value<Square, ORIGIN_SQUARE_MASK>() / SquaresPerRank]
-            + x[value<Piece, CAPTURED_PIECE_MASK>()]
-            + f[value<Square, TARGET_SQUARE_MASK>() % SquaresPerRank]
-            + r[value<Square, TARGET_SQUARE_MASK>() / SquaresPerRank]
-            + PR[value<Piece, PROMOTED_PIECE_MASK>()];
-    
-        if(result == "Ke1-g1 " || result == "Ke8-g8 ")
-        {
-            return "  0-0  ";
-        }
-        if(result == "Ke1-c1 " || result == "Ke8-c8 ") 
-        {
-            return " 0-0-0 ";
-        }       
-    
-        return result;
     }
 
     std::string HashEntry::getPrintOut() const
@@ -66,23 +25,12 @@ namespace spezi
         
         std::ostringstream hexRepresentation;
         hexRepresentation<<std::uppercase<<std::hex<<std::setw(16)<<std::setfill('0')<<zKey<<", 0x"<<move;
-        auto const epBefore = value<BitBoard, EN_PASSANT_BEFORE_MASK>();
-        auto const epBeforeStr = epBefore ? 
-            std::string(1, f[ffs(epBefore) % SquaresPerRank]) + r[ffs(epBefore) / SquaresPerRank]
-            : "-";
-        auto const epAfter = value<BitBoard, EN_PASSANT_AFTER_MASK>();
-        auto const epAfterStr = epAfter ? 
-            std::string(1, f[ffs(epAfter) % SquaresPerRank]) + r[ffs(epAfter) / SquaresPerRank]
-            : "-";
         
         return "0x" + hexRepresentation.str() + "\n"
             + "draft: " + std::to_string(value<int, DRAFT_MASK>())
             + ", score: " + std::to_string(value<MilliSquare, SCORE_MASK>())
             + ", type: " + type[value<HashEntryType, TYPE_MASK>()] + "\n"
-            + "move: " + getLongAlgebraicNotation() + "\n"
-            + "castling: " + std::to_string(value<unsigned char, CASTLING_BEFORE_MASK>()) 
-            + "->" + std::to_string(value<unsigned char, CASTLING_BEFORE_MASK>() & value<unsigned char, CASTLING_UPDATE_MASK>()) + "\n"
-            + "e.p.: " + epBeforeStr + "->" + epAfterStr + "\n";
+            + "move: " + value<Move, MOVE_MASK>().getUciNotation() + "\n";
     }
 
     HashTable::HashTable(size_t const sizeInMb)
@@ -163,4 +111,34 @@ namespace spezi
         entries.clear();
         entries.resize((indexMask + 1) * bucketSize);
     }
+
+    PerftTable::PerftTable(size_t const sizeInBytes)
+    : size(padToPowerOfTwo(sizeInBytes / sizeof(Entry))), entries(new Entry[size])
+    {
+        for(size_t i = 0; i < size; ++i)
+        {
+            entries[i].key = 0;
+            entries[i].data = 0;
+        }
+    }
+
+    bool PerftTable::get(ZKey const zKey, int const depth, int64_t & numberOfNodes) const
+    {
+        auto const & entry = entries[(zKey ^ depth) & (size - 1)];
+        auto const data = entry.data.load(std::memory_order_relaxed);
+        if((entry.key.load(std::memory_order_relaxed) ^ data) != zKey || (data & 0xFF) != static_cast<uint64_t>(depth))
+        {
+            return false;
+        }
+        numberOfNodes = static_cast<int64_t>(data >> 8);
+        return true;
+    }
+
+    void PerftTable::insert(ZKey const zKey, int const depth, int64_t const numberOfNodes)
+    {
+        auto & entry = entries[(zKey ^ depth) & (size - 1)];
+        auto const data = (static_cast<uint64_t>(numberOfNodes) << 8) | static_cast<uint64_t>(depth);
+        entry.key.store(zKey ^ data, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_relaxed);
+    }
 }
\ No newline at end of file
@@ -30,8 +30,16 @@ namespace spezi
     MobilityArray constexpr StaticMobilities = detail::averageMobilities<color, piece>(); 
     auto constexpr populationIndex(Square const population) { return population - 3; } 
 
+    // The evaluation reads the static mobilities of all colors, pieces and squares for one
+    // population only => keep them population-major, so one evaluation touches a single
+    // contiguous slab of 2 x 6 x 64 x 2 bytes = 1.5KB. Values reach about 36600 MilliSquares
+    // and are never negative, so they fit into unsigned 16 bit.
+    using PackedMobility = uint16_t;
+    using PopulationMobilities = std::array<std::array<std::array<PackedMobility, NumberOfSquares>, NumberOfPieceTypes>, NumberOfColors>;
+    std::array<PopulationMobilities, detail::MaxBoardPopulation-2> constexpr PackedStaticMobilities = detail::packedMobilities();
+
     // Static mobility of a white pawn on d4 on a half full board (3180 MilliSquares) 
-    MilliSquare constexpr PawnUnit = StaticMobilities<WHITE, PAWN>[d4][populationIndex(16)];
+    MilliSquare constexpr PawnUnit = PackedStaticMobilities[populationIndex(16)][WHITE][PAWN][d4];
 
     // Maximum expected mobility for a position (9 Queens x40000 + 7 Rooks x20000, including a safety margin)
     MilliSquare constexpr MaxExpectedMobility = 500000;
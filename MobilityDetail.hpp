@@ -19,18 +19,15 @@ namespace spezi::detail
         }
         else if constexpr(piece == QUEEN)
         {
-            result = (RankAttacks[square][pext(bb, RankMasks[square])]
-                    | FileAttacks[square][pext(bb, FileMasks[square])]
-                    | DiagonalAttacks[square][pext(bb,DiagonalMasks[square])]);
+            result = rookAttacks(square, bb) | bishopAttacks(square, bb);
         }
         else if constexpr(piece == ROOK)
         {
-            result = (RankAttacks[square][pext(bb, RankMasks[square])]
-                    | FileAttacks[square][pext(bb, FileMasks[square])]);
+            result = rookAttacks(square, bb);
         }
         else if constexpr(piece == BISHOP)
         {
-            result = DiagonalAttacks[square][pext(bb, DiagonalMasks[square])];
+            result = bishopAttacks(square, bb);
         }
         else if constexpr(piece == KNIGHT)
         {
@@ -50,6 +47,74 @@ namespace spezi::detail
         return result;
     }
 
+#ifdef __AVX2__
+    // per lane shift left or right, the unused direction shifts by >= 64, i.e. to zero
+    static inline __m256i shiftLanes(__m256i const bits, __m256i const leftShifts, __m256i const rightShifts)
+    {
+        return _mm256_or_si256(_mm256_sllv_epi64(bits, leftShifts), _mm256_srlv_epi64(bits, rightShifts));
+    }
+
+    // Kogge-Stone occluded fill of a set of sliders in four directions at once, one 64 bit
+    // lane per direction, wrap clears the file the shifted squares must not wrap into
+    static inline BitBoard slidingAttacksSet(BitBoard const sliders, BitBoard const occupied,
+        __m256i const leftShifts, __m256i const rightShifts, __m256i const wrap)
+    {
+        auto const left2 = _mm256_add_epi64(leftShifts, leftShifts);
+        auto const right2 = _mm256_add_epi64(rightShifts, rightShifts);
+        auto const left4 = _mm256_add_epi64(left2, left2);
+        auto const right4 = _mm256_add_epi64(right2, right2);
+
+        auto generator = _mm256_set1_epi64x(sliders);
+        auto propagator = _mm256_and_si256(_mm256_set1_epi64x(~occupied), wrap);
+
+        generator = _mm256_or_si256(generator, _mm256_and_si256(propagator, shiftLanes(generator, leftShifts, rightShifts)));
+        propagator = _mm256_and_si256(propagator, shiftLanes(propagator, leftShifts, rightShifts));
+        generator = _mm256_or_si256(generator, _mm256_and_si256(propagator, shiftLanes(generator, left2, right2)));
+        propagator = _mm256_and_si256(propagator, shiftLanes(propagator, left2, right2));
+        generator = _mm256_or_si256(generator, _mm256_and_si256(propagator, shiftLanes(generator, left4, right4)));
+
+        // one more step onto the blockers, then OR the four lanes
+        auto const attacks = _mm256_and_si256(shiftLanes(generator, leftShifts, rightShifts), wrap);
+        auto const halves = _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+        return _mm_cvtsi128_si64(_mm_or_si128(halves, _mm_unpackhi_epi64(halves, halves)));
+    }
+#endif
+
+    // union of the attacks of all rooks (or bishops) in a set, the direction lanes are
+    // N, E, S, W and NE, NW, SE, SW
+    static inline BitBoard rookAttacksSet(BitBoard rooks, BitBoard const occupied)
+    {
+#ifdef __AVX2__
+        return slidingAttacksSet(rooks, occupied, 
+            _mm256_setr_epi64x(SquaresPerRank, 1, 64, 64), _mm256_setr_epi64x(64, 64, SquaresPerRank, 1),
+            _mm256_setr_epi64x(~EMPTY, ~FILES[0], ~EMPTY, ~FILES[SquaresPerRank - 1]));
+#else
+        auto result = EMPTY;
+        for(; rooks; rooks &= rooks - 1)
+        {
+            result |= rookAttacks(ffs(rooks), occupied);
+        }
+        return result;
+#endif
+    }
+
+    static inline BitBoard bishopAttacksSet(BitBoard bishops, BitBoard const occupied)
+    {
+#ifdef __AVX2__
+        return slidingAttacksSet(bishops, occupied, 
+            _mm256_setr_epi64x(SquaresPerRank + 1, SquaresPerRank - 1, 64, 64), 
+            _mm256_setr_epi64x(64, 64, SquaresPerRank - 1, SquaresPerRank + 1),
+            _mm256_setr_epi64x(~FILES[0], ~FILES[SquaresPerRank - 1], ~FILES[0], ~FILES[SquaresPerRank - 1]));
+#else
+        auto result = EMPTY;
+        for(; bishops; bishops &= bishops - 1)
+        {
+            result |= bishopAttacks(ffs(bishops), occupied);
+        }
+        return result;
+#endif
+    }
+
     BitBoard random(Square const square, Square const population, 
         std::mt19937_64 & gen, std::uniform_int_distribution<Square> & dis);
     
@@ -180,4 +245,31 @@ namespace spezi::detail
         }
         return result;
     }
+
+    // same values as averageMobilities<color, piece>(), but population-major and 16 bit wide
+    auto constexpr packedMobilities()
+    {
+        std::array<std::array<std::array<std::array<uint16_t, NumberOfSquares>, NumberOfPieceTypes>, NumberOfColors>, 
+            MaxBoardPopulation-2> result {};
+        for(auto population = 3; population <= MaxBoardPopulation; ++population)
+        {
+            for(auto const color : {WHITE, BLACK})
+            {
+                for(auto const piece : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING})
+                {
+                    for(auto square = a1; square != OFF_BOARD; ++square)
+                    {
+                        auto const flippedSquare = (color == WHITE ? square : NumberOfSquares-square-1);
+                        auto const value = static_cast<int>(averageMobility(piece, flippedSquare, population) * 1024 + 0.5);
+                        if(value < 0 || value > 0xFFFF)
+                        {
+                            throw std::runtime_error("static mobility does not fit into 16 bits");
+                        }
+                        result[population-3][color][piece][square] = static_cast<uint16_t>(value);
+                    }
+                }
+            }
+        }
+        return result;
+    }
 }
@@ -0,0 +1,32 @@
+#include "Move.hpp"
+
+namespace spezi
+{
+    namespace
+    {
+        char constexpr f[] = "abcdefgh";
+        char constexpr r[] = "12345678";
+        char constexpr pr[] = " nbrq ";
+    }
+
+    std::string Move::getUciNotation() const
+    {
+        if(isNull())
+        {
+            return "0000";
+        }
+
+        auto result = std::string{}
+            + f[origin() % SquaresPerRank]
+            + r[origin() / SquaresPerRank]
+            + f[target() % SquaresPerRank]
+            + r[target() / SquaresPerRank];
+
+        if(type() == PROMOTION)
+        {
+            result += pr[promoted()];
+        }
+
+        return result;
+    }
+}
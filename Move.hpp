@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Piece.hpp"
+#include "Square.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace spezi
+{
+    // 16 bit move: everything else needed to take it back (moved and captured piece,
+    // castling rights, en passant square, half move clock) is kept on the undo stack
+    class Move
+    {
+    public:
+        enum Type
+        {
+            NORMAL = 0,
+            PROMOTION = 1,
+            EN_PASSANT = 2,
+            CASTLING = 3
+        };
+
+        // bits 0-5:    origin square
+        static uint16_t constexpr ORIGIN_MASK   = 0x003F;
+        // bits 6-11:   target square
+        static uint16_t constexpr TARGET_MASK   = 0x0FC0;
+        // bits 12-13:  promoted piece - KNIGHT
+        static uint16_t constexpr PROMOTED_MASK = 0x3000;
+        // bits 14-15:  type
+        static uint16_t constexpr TYPE_MASK     = 0xC000;
+
+        // null move (origin == target == a1)
+        constexpr Move() = default;
+
+        constexpr explicit Move(uint16_t const bits)
+        : bits(bits)
+        {}
+
+        constexpr Move(Square const origin, Square const target, Type const type = NORMAL, Piece const promoted = KNIGHT)
+        : bits(static_cast<uint16_t>(origin | (target << 6) | ((promoted - KNIGHT) << 12) | (type << 14)))
+        {}
+
+        Square constexpr origin() const
+        {
+            return bits & ORIGIN_MASK;
+        }
+
+        Square constexpr target() const
+        {
+            return (bits & TARGET_MASK) >> 6;
+        }
+
+        Piece constexpr promoted() const
+        {
+            return static_cast<Piece>(((bits & PROMOTED_MASK) >> 12) + KNIGHT);
+        }
+
+        Type constexpr type() const
+        {
+            return static_cast<Type>(bits >> 14);
+        }
+
+        bool constexpr isNull() const
+        {
+            return bits == 0;
+        }
+
+        uint16_t constexpr raw() const
+        {
+            return bits;
+        }
+
+        bool constexpr operator==(Move const other) const
+        {
+            return bits == other.bits;
+        }
+
+        bool constexpr operator!=(Move const other) const
+        {
+            return bits != other.bits;
+        }
+
+        std::string getUciNotation() const;
+
+    private:
+        uint16_t bits = 0;
+    };
+}
@@ -0,0 +1,190 @@
+#include "NeuralNetwork.hpp"
+
+#include "NeuralNetworkDetail.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace spezi
+{
+    namespace
+    {
+        char constexpr Magic[] = "SPEZINN1";
+
+        // scale of the hidden layer outputs (weights are trained with 6 fractional bits)
+        auto constexpr WeightScaleBits = 6;
+        // network output units per centipawn
+        auto constexpr OutputScale = 16;
+
+        // features are seen from both sides: black's view is the board rotated by 180 degrees
+        auto constexpr orient(Color const perspective, Square const square)
+        {
+            return perspective == WHITE ? square : square ^ (NumberOfSquares - 1);
+        }
+
+        auto constexpr featureIndex(Color const perspective, Square const kingSquare,
+            Color const color, Piece const piece, Square const square)
+        {
+            auto const featurePiece = piece * 2 + (color != perspective);
+            return orient(perspective, kingSquare) * FeaturesPerKingSquare
+                + 1 + featurePiece * NumberOfSquares + orient(perspective, square);
+        }
+
+        template<typename Value>
+        void read(std::ifstream & file, std::vector<Value> & values, size_t const size)
+        {
+            values.resize(size);
+            file.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(size * sizeof(Value)));
+        }
+
+        template<int inputSize, int outputSize>
+        void affineClippedReLU(uint8_t const * const input, std::vector<int8_t> const & weights,
+            std::vector<int32_t> const & biases, uint8_t * const output)
+        {
+            for(auto i = 0; i < outputSize; ++i)
+            {
+                auto const sum = (biases[i] + detail::dot<inputSize>(input, &weights[i * inputSize])) >> WeightScaleBits;
+                output[i] = static_cast<uint8_t>(std::clamp(sum, 0, 127));
+            }
+        }
+    }
+
+    void NeuralNetwork::load(std::string const & fileName)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        if(!file)
+        {
+            throw std::runtime_error("cannot open network file: " + fileName);
+        }
+
+        char magic[sizeof(Magic) - 1];
+        file.read(magic, sizeof(magic));
+        if(!file || std::memcmp(magic, Magic, sizeof(magic)) != 0)
+        {
+            throw std::runtime_error("not a spezi network file: " + fileName);
+        }
+
+        NeuralNetwork network;
+        read(file, network.featureBiases, AccumulatorSize);
+        read(file, network.featureWeights, static_cast<size_t>(NumberOfFeatures) * AccumulatorSize);
+        read(file, network.hidden1Biases, HiddenSize);
+        read(file, network.hidden1Weights, HiddenSize * 2 * AccumulatorSize);
+        read(file, network.hidden2Biases, HiddenSize);
+        read(file, network.hidden2Weights, HiddenSize * HiddenSize);
+        file.read(reinterpret_cast<char *>(&network.outputBias), sizeof(network.outputBias));
+        read(file, network.outputWeights, HiddenSize);
+
+        if(!file || file.peek() != std::ifstream::traits_type::eof())
+        {
+            throw std::runtime_error("network file has wrong size: " + fileName);
+        }
+
+        *this = std::move(network);
+    }
+
+    bool NeuralNetwork::isLoaded() const
+    {
+        return !outputWeights.empty();
+    }
+
+    void NeuralNetwork::refresh(Accumulator & accumulator, Color const perspective, PieceSets const & pieces) const
+    {
+        auto & values = accumulator.values[perspective];
+        std::copy(featureBiases.begin(), featureBiases.end(), values.begin());
+
+        auto const kingSquare = ffs(pieces.piecesOf(perspective, KING));
+        for(auto const color : {WHITE, BLACK})
+        {
+            for(auto const piece : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN})
+            {
+                auto squares = pieces.piecesOf(color, piece);
+                while(squares)
+                {
+                    auto const feature = featureIndex(perspective, kingSquare, color, piece, ffs(squares));
+                    detail::addWeights<AccumulatorSize>(values.data(), &featureWeights[feature * AccumulatorSize]);
+                    squares &= squares - 1;
+                }
+            }
+        }
+    }
+
+    void NeuralNetwork::update(Accumulator & accumulator, Accumulator const & base,
+        PieceSets const & pieces) const
+    {
+        BitBoard removed[NumberOfColors][NumberOfPieceTypes - 1];
+        BitBoard added[NumberOfColors][NumberOfPieceTypes - 1];
+        auto changes = 0;
+        auto population = 0;
+
+        for(auto const color : {WHITE, BLACK})
+        {
+            for(auto const piece : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN})
+            {
+                auto const before = base.pieces.piecesOf(color, piece);
+                auto const after = pieces.piecesOf(color, piece);
+                removed[color][piece] = before & ~after;
+                added[color][piece] = after & ~before;
+                changes += popcount(removed[color][piece]) + popcount(added[color][piece]);
+                population += popcount(after);
+            }
+        }
+
+        for(auto const perspective : {WHITE, BLACK})
+        {
+            auto const kingSquare = ffs(pieces.piecesOf(perspective, KING));
+            auto const baseKingSquare = ffs(base.pieces.piecesOf(perspective, KING));
+
+            // king moves change every feature of this perspective,
+            // distant bases may differ in more pieces than a refresh has to add
+            if(!base.computed || kingSquare != baseKingSquare || changes >= population)
+            {
+                refresh(accumulator, perspective, pieces);
+                continue;
+            }
+
+            auto & values = accumulator.values[perspective];
+            if(&accumulator != &base)
+            {
+                values = base.values[perspective];
+            }
+
+            for(auto const color : {WHITE, BLACK})
+            {
+                for(auto const piece : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN})
+                {
+                    for(auto squares = removed[color][piece]; squares; squares &= squares - 1)
+                    {
+                        auto const feature = featureIndex(perspective, kingSquare, color, piece, ffs(squares));
+                        detail::subtractWeights<AccumulatorSize>(values.data(), &featureWeights[feature * AccumulatorSize]);
+                    }
+                    for(auto squares = added[color][piece]; squares; squares &= squares - 1)
+                    {
+                        auto const feature = featureIndex(perspective, kingSquare, color, piece, ffs(squares));
+                        detail::addWeights<AccumulatorSize>(values.data(), &featureWeights[feature * AccumulatorSize]);
+                    }
+                }
+            }
+        }
+
+        accumulator.pieces = pieces;
+        accumulator.computed = true;
+    }
+
+    int NeuralNetwork::evaluate(Accumulator const & accumulator, Color const sideToMove) const
+    {
+        alignas(32) uint8_t input[2 * AccumulatorSize];
+        alignas(32) uint8_t hidden1[HiddenSize];
+        alignas(32) uint8_t hidden2[HiddenSize];
+
+        // side to move first
+        detail::clippedReLU<AccumulatorSize>(accumulator.values[sideToMove].data(), input);
+        detail::clippedReLU<AccumulatorSize>(accumulator.values[sideToMove ^ BLACK].data(), input + AccumulatorSize);
+
+        affineClippedReLU<2 * AccumulatorSize, HiddenSize>(input, hidden1Weights, hidden1Biases, hidden1);
+        affineClippedReLU<HiddenSize, HiddenSize>(hidden1, hidden2Weights, hidden2Biases, hidden2);
+
+        return (outputBias + detail::dot<HiddenSize>(hidden2, outputWeights.data())) / OutputScale;
+    }
+}
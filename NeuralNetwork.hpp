@@ -0,0 +1,71 @@
+#pragma once
+
+#include "BitBoard.hpp"
+#include "Color.hpp"
+#include "Piece.hpp"
+#include "PieceBitBoards.hpp"
+#include "Square.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace spezi
+{
+    // HalfKP input features: for each perspective, the (own) king square combined with
+    // every non-king piece (color relative to the perspective, type, square)
+    // => 64 king squares x (10 pieces x 64 squares + 1) = 41024 features per perspective
+    auto constexpr NumberOfFeaturePieces = 2 * (NumberOfPieceTypes - 1);
+    auto constexpr FeaturesPerKingSquare = NumberOfFeaturePieces * NumberOfSquares + 1;
+    auto constexpr NumberOfFeatures = NumberOfSquares * FeaturesPerKingSquare;
+
+    // network topology: 2 x 256 (int16 accumulators) -> 32 -> 32 (int8 weights) -> 1
+    auto constexpr AccumulatorSize = 256;
+    auto constexpr HiddenSize = 32;
+
+    // Accumulators are kept per ply. Each one remembers the piece sets it was computed from,
+    // so it can be brought up to date from any other accumulator (usually the parent ply's)
+    // by adding/subtracting the features of the squares that differ.
+    struct alignas(32) Accumulator
+    {
+        std::array<std::array<int16_t, AccumulatorSize>, NumberOfColors> values;
+        PieceSets pieces;
+        bool computed = false;
+    };
+
+    // Efficiently updatable neural network evaluation (CPU only, AVX2/SSE4.1 with scalar fallback).
+    // Network file layout (little endian, no padding):
+    //  char[8]                             "SPEZINN1"
+    //  int16[256]                          feature transformer biases
+    //  int16[41024][256]                   feature transformer weights
+    //  int32[32], int8[32][512]            first hidden layer biases, weights
+    //  int32[32], int8[32][32]             second hidden layer biases, weights
+    //  int32, int8[32]                     output bias, weights
+    class NeuralNetwork
+    {
+    public:
+        void load(std::string const & fileName);
+        bool isLoaded() const;
+
+        // bring accumulator up to date with the given pieces, starting from base
+        // (which may be the accumulator itself or an accumulator of another ply)
+        void update(Accumulator & accumulator, Accumulator const & base,
+            PieceSets const & pieces) const;
+
+        // score relative to the side to move, in centipawns
+        int evaluate(Accumulator const & accumulator, Color sideToMove) const;
+
+    private:
+        void refresh(Accumulator & accumulator, Color perspective, PieceSets const & pieces) const;
+
+        std::vector<int16_t> featureBiases;
+        std::vector<int16_t> featureWeights;
+        std::vector<int32_t> hidden1Biases;
+        std::vector<int8_t> hidden1Weights;
+        std::vector<int32_t> hidden2Biases;
+        std::vector<int8_t> hidden2Weights;
+        int32_t outputBias = 0;
+        std::vector<int8_t> outputWeights;
+    };
+}
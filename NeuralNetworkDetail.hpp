@@ -0,0 +1,128 @@
+#pragma once
+
+#include <x86intrin.h>
+
+#include <cstdint>
+
+namespace spezi::detail
+{
+    // accumulator[i] += weights[i] for one perspective (AccumulatorSize values)
+    template<int size>
+    static inline void addWeights(int16_t * const accumulator, int16_t const * const weights)
+    {
+#if defined(__AVX2__)
+        for(auto i = 0; i < size; i += 16)
+        {
+            auto * const a = reinterpret_cast<__m256i *>(accumulator + i);
+            auto const w = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(weights + i));
+            _mm256_store_si256(a, _mm256_add_epi16(_mm256_load_si256(a), w));
+        }
+#elif defined(__SSE4_1__)
+        for(auto i = 0; i < size; i += 8)
+        {
+            auto * const a = reinterpret_cast<__m128i *>(accumulator + i);
+            auto const w = _mm_loadu_si128(reinterpret_cast<__m128i const *>(weights + i));
+            _mm_store_si128(a, _mm_add_epi16(_mm_load_si128(a), w));
+        }
+#else
+        for(auto i = 0; i < size; ++i)
+        {
+            accumulator[i] += weights[i];
+        }
+#endif
+    }
+
+    // accumulator[i] -= weights[i] for one perspective (AccumulatorSize values)
+    template<int size>
+    static inline void subtractWeights(int16_t * const accumulator, int16_t const * const weights)
+    {
+#if defined(__AVX2__)
+        for(auto i = 0; i < size; i += 16)
+        {
+            auto * const a = reinterpret_cast<__m256i *>(accumulator + i);
+            auto const w = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(weights + i));
+            _mm256_store_si256(a, _mm256_sub_epi16(_mm256_load_si256(a), w));
+        }
+#elif defined(__SSE4_1__)
+        for(auto i = 0; i < size; i += 8)
+        {
+            auto * const a = reinterpret_cast<__m128i *>(accumulator + i);
+            auto const w = _mm_loadu_si128(reinterpret_cast<__m128i const *>(weights + i));
+            _mm_store_si128(a, _mm_sub_epi16(_mm_load_si128(a), w));
+        }
+#else
+        for(auto i = 0; i < size; ++i)
+        {
+            accumulator[i] -= weights[i];
+        }
+#endif
+    }
+
+    // clamp int16 accumulator values to [0, 127] and narrow to 8 bits
+    template<int size>
+    static inline void clippedReLU(int16_t const * const input, uint8_t * const output)
+    {
+#if defined(__AVX2__)
+        auto const zero = _mm256_setzero_si256();
+        for(auto i = 0; i < size; i += 32)
+        {
+            auto const a = _mm256_load_si256(reinterpret_cast<__m256i const *>(input + i));
+            auto const b = _mm256_load_si256(reinterpret_cast<__m256i const *>(input + i + 16));
+            // packs works on 128 bit lanes => restore order with a cross-lane permutation
+            auto const packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(a, b), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), _mm256_max_epi8(packed, zero));
+        }
+#elif defined(__SSE4_1__)
+        auto const zero = _mm_setzero_si128();
+        for(auto i = 0; i < size; i += 16)
+        {
+            auto const a = _mm_load_si128(reinterpret_cast<__m128i const *>(input + i));
+            auto const b = _mm_load_si128(reinterpret_cast<__m128i const *>(input + i + 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_max_epi8(_mm_packs_epi16(a, b), zero));
+        }
+#else
+        for(auto i = 0; i < size; ++i)
+        {
+            output[i] = static_cast<uint8_t>(input[i] < 0 ? 0 : input[i] > 127 ? 127 : input[i]);
+        }
+#endif
+    }
+
+    // dot product of unsigned 8 bit activations in [0, 127] with signed 8 bit weights
+    template<int size>
+    static inline int32_t dot(uint8_t const * const input, int8_t const * const weights)
+    {
+#if defined(__AVX2__)
+        auto const ones = _mm256_set1_epi16(1);
+        auto sum = _mm256_setzero_si256();
+        for(auto i = 0; i < size; i += 32)
+        {
+            auto const in = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(input + i));
+            auto const w = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(weights + i));
+            // pairwise products fit into int16 because activations are clipped to 127
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+        }
+        auto const half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        auto const quarter = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+        return _mm_cvtsi128_si32(_mm_add_epi32(quarter, _mm_shuffle_epi32(quarter, 0xB1)));
+#elif defined(__SSE4_1__)
+        auto const ones = _mm_set1_epi16(1);
+        auto sum = _mm_setzero_si128();
+        for(auto i = 0; i < size; i += 16)
+        {
+            auto const in = _mm_loadu_si128(reinterpret_cast<__m128i const *>(input + i));
+            auto const w = _mm_loadu_si128(reinterpret_cast<__m128i const *>(weights + i));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(in, w), ones));
+        }
+        auto const half = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        return _mm_cvtsi128_si32(_mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1)));
+#else
+        int32_t sum = 0;
+        for(auto i = 0; i < size; ++i)
+        {
+            sum += static_cast<int32_t>(input[i]) * weights[i];
+        }
+        return sum;
+#endif
+    }
+}
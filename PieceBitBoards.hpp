@@ -0,0 +1,136 @@
+#pragma once
+
+#include "BitBoard.hpp"
+#include "Color.hpp"
+#include "Piece.hpp"
+
+// represent the pieces by four bitboards holding a 4 bit code per square (QuadBitBoard)
+// instead of color, piece type and empty square bitboards (PieceBitBoards)
+//#define QUAD_BITBOARD
+
+namespace spezi
+{
+    // one bitboard per color and per piece type plus the empty squares (9 words)
+    class PieceBitBoards
+    {
+    public:
+        BitBoard constexpr emptySquares() const
+        {
+            return empty;
+        }
+
+        BitBoard constexpr piecesOf(Color const color) const
+        {
+            return allPieces[color];
+        }
+
+        BitBoard constexpr piecesOfType(int const piece) const
+        {
+            return individualPieces[piece];
+        }
+
+        BitBoard constexpr piecesOf(Color const color, int const piece) const
+        {
+            return allPieces[color] & individualPieces[piece];
+        }
+
+        // bishops and queens
+        BitBoard constexpr diagonalSliders() const
+        {
+            return individualPieces[BISHOP] | individualPieces[QUEEN];
+        }
+
+        // rooks and queens
+        BitBoard constexpr orthogonalSliders() const
+        {
+            return individualPieces[ROOK] | individualPieces[QUEEN];
+        }
+
+        // put pieces of one color and type on empty squares or remove them
+        void constexpr togglePieces(Color const color, int const piece, BitBoard const squares)
+        {
+            allPieces[color] ^= squares;
+            individualPieces[piece] ^= squares;
+            empty ^= squares;
+        }
+
+        void constexpr clearPieces()
+        {
+            *this = PieceBitBoards {};
+        }
+
+    private:
+        BitBoard empty = ~EMPTY;
+        BitBoard allPieces[NumberOfColors] = {};
+        BitBoard individualPieces[NumberOfPieceTypes] = {};
+    };
+
+    // Four bitboards holding a 4 bit code per square: piece type + 1 in bits 0-2 (0: empty square)
+    // and the color in bit 3. Every set of pieces is derived with at most four logical operations,
+    // putting or removing a piece touches at most four words.
+    class QuadBitBoard
+    {
+    public:
+        BitBoard constexpr emptySquares() const
+        {
+            return ~(bits[0] | bits[1] | bits[2]);
+        }
+
+        BitBoard constexpr piecesOf(Color const color) const
+        {
+            return (bits[0] | bits[1] | bits[2]) & (bits[3] ^ select(color ^ BLACK));
+        }
+
+        BitBoard constexpr piecesOfType(int const piece) const
+        {
+            auto const code = piece + 1;
+            return (bits[0] ^ select(~code & 1)) & (bits[1] ^ select(~code >> 1 & 1)) & (bits[2] ^ select(~code >> 2 & 1));
+        }
+
+        BitBoard constexpr piecesOf(Color const color, int const piece) const
+        {
+            return piecesOfType(piece) & (bits[3] ^ select(color ^ BLACK));
+        }
+
+        // codes 3 (bishop) and 5 (queen)
+        BitBoard constexpr diagonalSliders() const
+        {
+            return bits[0] & (bits[1] ^ bits[2]);
+        }
+
+        // codes 4 (rook) and 5 (queen)
+        BitBoard constexpr orthogonalSliders() const
+        {
+            return bits[2] & ~bits[1];
+        }
+
+        void constexpr togglePieces(Color const color, int const piece, BitBoard const squares)
+        {
+            auto const code = (piece + 1) | (color << 3);
+            for(auto i = 0; i < 4; ++i)
+            {
+                bits[i] ^= squares & select(code >> i & 1);
+            }
+        }
+
+        void constexpr clearPieces()
+        {
+            *this = QuadBitBoard {};
+        }
+
+    private:
+        // all bits set for 1, no bits set for 0
+        static BitBoard constexpr select(int const bit)
+        {
+            return EMPTY - static_cast<BitBoard>(bit);
+        }
+
+        BitBoard bits[4] = {};
+    };
+
+#ifdef QUAD_BITBOARD
+    using PieceSets = QuadBitBoard;
+#else
+    using PieceSets = PieceBitBoards;
+#endif
+}
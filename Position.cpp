@@ -9,7 +9,9 @@
 #include <sstream>
 #include <thread>
 
-//#define PERFT
+// sum piece-square mobilities of pawns, knights, bishops and rooks with AVX2 gathers
+// (falls back to the scalar loop in staticPieceEvaluation when AVX2 is not available)
+//#define GATHER_EVALUATION
 
 namespace spezi
 {
@@ -25,11 +27,11 @@ namespace spezi
         auto constexpr NO_PIECE = NumberOfPieceTypes * 2;
         auto constexpr PIECE_ERROR = NumberOfPieceTypes * 2 + 1;
         
-        auto constexpr pieceBoard(
-            BitBoard const empty,
-            BitBoard const (&allPieces)[NumberOfColors],
-            BitBoard const (&individualPieces)[NumberOfPieceTypes])
+        auto constexpr pieceBoard(PieceSets const & pieces)
         {
+            auto const empty = pieces.emptySquares();
+            BitBoard const allPieces[] = { pieces.piecesOf(WHITE), pieces.piecesOf(BLACK) };
+
             std::array<int, NumberOfSquares> retval {};
             
             for(auto const square : SQUARES)
@@ -41,11 +43,11 @@ namespace spezi
 
                 auto & result = retval[ffs(square)];
                 result = NO_PIECE;    
-                int pieces = 0;
+                int count = 0;
 
                 for(auto const piece : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING })
                 {
-                    if(individualPieces[piece] & square)
+                    if(pieces.piecesOfType(piece) & square)
                     {
                         if(allPieces[WHITE] & square)
                         {
@@ -56,11 +58,11 @@ namespace spezi
                             result = NumberOfPieceTypes + piece;
                         }
                         
-                        ++ pieces;
+                        ++ count;
                     }
                 }
 
-                switch(pieces)
+                switch(count)
                 {
                 case 0:
                     if((allPieces[WHITE]
@@ -103,17 +105,111 @@ namespace spezi
         }
 
         template<Color color, Piece piece>
-        static inline MilliSquare staticPieceEvaluation(BitBoard pieces, int const p)
+        static inline MilliSquare staticPieceEvaluation(BitBoard pieces, PopulationMobilities const & mobilities)
         {
             MilliSquare value = 0;
             while(pieces)
             {   
-                value += StaticMobilities<color, piece>[ffs(pieces)][p];
+                value += mobilities[color][piece][ffs(pieces)];
                 pieces &= pieces - 1;
             }
             return value;
         }
 
+#if defined(GATHER_EVALUATION) && defined(__AVX2__)
+        // Collect up to 8 indices (piece * 64 + square) of a color's pawns, knights, bishops and
+        // rooks at a time and fetch their 16 bit mobilities with a single vpgatherdd: 32 bit loads
+        // at a 2 byte scale, the upper halves (neighboring entries) are masked off afterwards.
+        // The last possible index (rook on h8) still reads inside the table (queen on a1).
+        template<Color color>
+        static inline __m256i gatherPieceEvaluation(BitBoard const pawns, BitBoard const knights,
+            BitBoard const bishops, BitBoard const rooks, PopulationMobilities const & mobilities)
+        {
+            auto const base = reinterpret_cast<int const *>(mobilities[color][PAWN].data());
+            auto const lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            auto const lowHalves = _mm256_set1_epi32(0xFFFF);
+            auto sum = _mm256_setzero_si256();
+
+            alignas(32) int32_t indices[8];
+            auto numberOfIndices = 0;
+            BitBoard const pieces[] = {pawns, knights, bishops, rooks};
+            
+            for(auto piece = static_cast<int>(PAWN); piece <= static_cast<int>(ROOK); ++piece)
+            {
+                for(auto remaining = pieces[piece]; remaining; remaining &= remaining - 1)
+                {
+                    indices[numberOfIndices++] = static_cast<int32_t>(piece * NumberOfSquares + ffs(remaining));
+                    if(numberOfIndices == 8)
+                    {
+                        auto const values = _mm256_i32gather_epi32(base, _mm256_load_si256(reinterpret_cast<__m256i const *>(indices)), 2);
+                        sum = _mm256_add_epi32(sum, _mm256_and_si256(values, lowHalves));
+                        numberOfIndices = 0;
+                    }
+                }
+            }
+
+            if(numberOfIndices)
+            {
+                auto const active = _mm256_cmpgt_epi32(_mm256_set1_epi32(numberOfIndices), lanes);
+                auto const values = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), base, 
+                    _mm256_and_si256(_mm256_load_si256(reinterpret_cast<__m256i const *>(indices)), active), active, 2);
+                sum = _mm256_add_epi32(sum, _mm256_and_si256(values, lowHalves));
+            }
+
+            return sum;
+        }
+
+        static inline MilliSquare horizontalSum(__m256i const values)
+        {
+            auto const half = _mm_add_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+            auto const quarter = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+            return _mm_cvtsi128_si32(_mm_add_epi32(quarter, _mm_shuffle_epi32(quarter, 0xB1)));
+        }
+#endif
+
+        // all squares attacked by the given pawns, computed set-wise
+        template<Color color>
+        static inline BitBoard pawnAttackSet(BitBoard const pawns)
+        {
+            if constexpr(color == WHITE)
+            {
+                return ((pawns << (SquaresPerRank - 1)) & ~FILES[SquaresPerRank - 1]) 
+                    | ((pawns << (SquaresPerRank + 1)) & ~FILES[0]);
+            }
+            else
+            {
+                return ((pawns >> (SquaresPerRank + 1)) & ~FILES[SquaresPerRank - 1]) 
+                    | ((pawns >> (SquaresPerRank - 1)) & ~FILES[0]);
+            }
+        }
+
+        // set-wise pawn moves: all pawns of a side are shifted at once, the origin of every
+        // target is the target minus the offset (captures towards the a-file are "west")
+        Square constexpr PawnPushOffset[NumberOfColors] = { SquaresPerRank, -SquaresPerRank };
+        Square constexpr WestCaptureOffset[NumberOfColors] = { SquaresPerRank - 1, -SquaresPerRank - 1 };
+        Square constexpr EastCaptureOffset[NumberOfColors] = { SquaresPerRank + 1, -SquaresPerRank + 1 };
+
+        static inline BitBoard shiftBy(BitBoard const squares, Square const offset)
+        {
+            return offset > 0 ? squares << offset : squares >> -offset;
+        }
+
+        // attacks of all pieces of the given type, plus the number of attacked squares
+        // (per piece) that are safe to move to
+        template<Piece piece>
+        static inline BitBoard pieceAttacks(BitBoard pieces, BitBoard const occupied, BitBoard const safe, Square & safeMobility)
+        {
+            auto result = EMPTY;
+            while(pieces)
+            {
+                auto const attacks = detail::reachable<piece>(ffs(pieces), occupied);
+                result |= attacks;
+                safeMobility += popcount(attacks & safe);
+                pieces &= pieces - 1;
+            }
+            return result;
+        }
+
         static inline unsigned char castlingCaptureUpdateFlags(BitBoard const from, BitBoard const to)
         {
             auto const wKing = popcount(E1 & from);
@@ -150,8 +246,9 @@ namespace spezi
                 return " score cp " + std::to_string(evaluation * 100 / PawnUnit * (sideToMove==WHITE ? 1 : -1));
             }
 
+            // mating side needs an odd number of plies, mated side an even number
             auto const movesToMate = evaluation > 0 ? 
-                std::to_string((MateValue - evaluation) / 2)
+                std::to_string((MateValue - evaluation + 1) / 2)
                 : std::to_string((evaluation + MateValue) / 2);
             
             if((sideToMove == WHITE && evaluation > 0) || (sideToMove == BLACK && evaluation < 0))
@@ -161,6 +258,59 @@ namespace spezi
 
             return " score mate -" + movesToMate;
         }
+
+        // follows a line of moves on a copy of the mailbox and the hash key
+        // without making them on the position
+        struct LineReplay
+        {
+            std::array<unsigned char, NumberOfSquares> board;
+            ZKey key;
+            Color side;
+            unsigned char castling;
+            BitBoard ep;
+
+            void play(Move const move)
+            {
+                auto const other = static_cast<Color>(side ^ BLACK);
+                auto const origin = move.origin();
+                auto const target = move.target();
+                auto const movedPiece = static_cast<Piece>(board[origin] % NumberOfPieceTypes);
+                auto const placedPiece = move.type() == Move::PROMOTION ? move.promoted() : movedPiece;
+                auto const capturedSquare = move.type() == Move::EN_PASSANT ? 
+                    target + ((side << 1) - 1) * SquaresPerRank : target;
+
+                key ^= BlackToMoveKey;
+                key ^= PieceKeys[side][movedPiece][origin];
+                key ^= PieceKeys[side][placedPiece][target];
+
+                if(board[capturedSquare] != NO_PIECE)
+                {
+                    key ^= PieceKeys[other][board[capturedSquare] % NumberOfPieceTypes][capturedSquare];
+                    board[capturedSquare] = NO_PIECE;
+                }
+                board[origin] = NO_PIECE;
+                board[target] = side * NumberOfPieceTypes + placedPiece;
+                
+                if(move.type() == Move::CASTLING)
+                {
+                    auto const rookOrigin = target > origin ? target + 1 : target - 2;
+                    auto const rookTarget = (origin + target) >> 1;
+                    key ^= PieceKeys[side][ROOK][rookOrigin];
+                    key ^= PieceKeys[side][ROOK][rookTarget];
+                    board[rookTarget] = board[rookOrigin];
+                    board[rookOrigin] = NO_PIECE;
+                }
+
+                key ^= ep ? EnPassantKeys[ffs(ep) % SquaresPerRank] : ZKey {0};
+                ep = (movedPiece == PAWN) ? (A1 << ((origin + target) >> 1)) & Files[origin] : EMPTY;
+                key ^= ep ? EnPassantKeys[ffs(ep) % SquaresPerRank] : ZKey {0};
+                key ^= CastlingKeys[castling];
+                castling &= castlingCaptureUpdateFlags(A1 << origin, A1 << target);
+                key ^= CastlingKeys[castling];
+
+                side = other;
+            }
+        };
     } 
 
     Position::Position(std::string fen, std::function<void(std::string)> outputFunction)
@@ -182,10 +332,7 @@ namespace spezi
             }
         }
 
-        individualPieces[PAWN]=individualPieces[KNIGHT]=
-            individualPieces[BISHOP]=individualPieces[ROOK]=
-            individualPieces[QUEEN]=individualPieces[KING]=
-            allPieces[WHITE] = allPieces[BLACK] = EMPTY;
+        clearPieces();
         
         std::replace(sections[0].begin(), sections[0].end(), '/', ' ');
         std::istringstream rankStream(sections[0]);
@@ -204,26 +351,24 @@ namespace spezi
             {
                 BitBoard s = A1 << (rankIndex * SquaresPerRank + file);
                 if(*next > 0x30 && *next < 0x39) { file += *next - 0x31; } 
-                else if(*next == 'P') { individualPieces[PAWN] ^= s; allPieces[WHITE] ^= s; }
-                else if(*next == 'N') { individualPieces[KNIGHT] ^= s; allPieces[WHITE] ^= s; }
-                else if(*next == 'B') { individualPieces[BISHOP] ^= s; allPieces[WHITE] ^= s; }
-                else if(*next == 'R') { individualPieces[ROOK] ^= s; allPieces[WHITE] ^= s; }
-                else if(*next == 'Q') { individualPieces[QUEEN] ^= s; allPieces[WHITE] ^= s; }
-                else if(*next == 'K') { individualPieces[KING] ^= s; allPieces[WHITE] ^= s; }
-                else if(*next == 'p') { individualPieces[PAWN] ^= s; allPieces[BLACK] ^= s; }
-                else if(*next == 'n') { individualPieces[KNIGHT] ^= s; allPieces[BLACK] ^= s; }
-                else if(*next == 'b') { individualPieces[BISHOP] ^= s; allPieces[BLACK] ^= s; }
-                else if(*next == 'r') { individualPieces[ROOK] ^= s; allPieces[BLACK] ^= s; }
-                else if(*next == 'q') { individualPieces[QUEEN] ^= s; allPieces[BLACK] ^= s; }
-                else if(*next == 'k') { individualPieces[KING] ^= s; allPieces[BLACK] ^= s; }
+                else if(*next == 'P') { togglePieces(WHITE, PAWN, s); }
+                else if(*next == 'N') { togglePieces(WHITE, KNIGHT, s); }
+                else if(*next == 'B') { togglePieces(WHITE, BISHOP, s); }
+                else if(*next == 'R') { togglePieces(WHITE, ROOK, s); }
+                else if(*next == 'Q') { togglePieces(WHITE, QUEEN, s); }
+                else if(*next == 'K') { togglePieces(WHITE, KING, s); }
+                else if(*next == 'p') { togglePieces(BLACK, PAWN, s); }
+                else if(*next == 'n') { togglePieces(BLACK, KNIGHT, s); }
+                else if(*next == 'b') { togglePieces(BLACK, BISHOP, s); }
+                else if(*next == 'r') { togglePieces(BLACK, ROOK, s); }
+                else if(*next == 'q') { togglePieces(BLACK, QUEEN, s); }
+                else if(*next == 'k') { togglePieces(BLACK, KING, s); }
                 else { throw std::runtime_error("Invalid rank in FEN: '" + rank + "'");}
                 ++next;
                 ++file;
             }
         }
 
-        empty = ~(allPieces[WHITE] | allPieces[BLACK]);
-
         if(sections[1] == "w")
         {
             sideToMove = WHITE;
@@ -257,27 +402,17 @@ namespace spezi
             throw std::runtime_error("Invalid castling rights: " + sections[2]);
         }
 
-        if(sections[2][0] != 'K')
-        {
-            castlingRights &= ~1;
-        }
-        if(sections[2][0] != 'Q' && sections[2][1] != 'Q')
-        {
-            castlingRights &= ~(1 << 1);            
-        }
-        if(sections[2][0] != 'k' && sections[2][1] != 'k' && sections[2][2] != 'k')
-        {
-            castlingRights &= ~(1 << 2);
-        }
-        if(sections[2][0] != 'q' && sections[2][1] != 'q' && sections[2][2] != 'q' && sections[2][3] != 'q')
-        {
-            castlingRights &= ~(1 << 3);
-        }
-        if(sections[2] == "-")
+        castlingRights = 0;
+        for(auto const flag : {'K', 'Q', 'k', 'q'})
         {
-            castlingRights = 0;
+            if(sections[2].find(flag) != std::string::npos)
+            {
+                castlingRights |= 1 << (std::string("KQkq").find(flag));
+            }
         }
 
+        enPassant = EMPTY;
+
         if(sections[3] != "-")
         {
             if(sections[3].size() != 2
@@ -309,13 +444,33 @@ namespace spezi
 
         for(auto index = 0; index != historySize; ++index)
         {
-            // empty history up until the played number of moves
+            // emptySquares() history up until the played number of moves
             history[index] = ZKey{};
         }
 
+        auto const board = pieceBoard(*this);
+
         zKey = sideToMove == WHITE ? 0 : BlackToMoveKey;
         zKey ^= CastlingKeys[castlingRights];
-        zKey ^= zKeyFromPieceBoard(pieceBoard(empty, allPieces, individualPieces));
+        zKey ^= enPassant ? EnPassantKeys[ffs(enPassant) % SquaresPerRank] : ZKey {0};
+        zKey ^= zKeyFromPieceBoard(board);
+
+        pieceCount = {};
+        for(Square square = 0; square < NumberOfSquares; ++square)
+        {
+            pieceOn[square] = NO_PIECE;
+            if(board[square] == NO_PIECE)
+            {
+                continue;
+            }
+
+            auto const color = static_cast<Color>(board[square] / NumberOfPieceTypes);
+            if(pieceCount[color] == MAX_PIECES_PER_SIDE)
+            {
+                throw std::runtime_error("Too many pieces in FEN: '" + fen + "'");
+            }
+            putPiece(color, static_cast<Piece>(board[square] % NumberOfPieceTypes), square);
+        }
     }
 
     void Position::makeMoves(std::vector<std::string>::const_iterator begin, std::vector<std::string>::const_iterator const end)
@@ -359,22 +514,100 @@ namespace spezi
         suppressFaultyPv = suppressPv; 
     }
 
+    void Position::setDynamicMobilityWeight(unsigned int const weight)
+    {
+        if(weight > 100)
+        {
+            throw std::runtime_error("dynamic mobility weight must not exceed 100%");
+        }
+        dynamicMobilityWeight = weight;
+    }
+
+    void Position::setNetworkFile(std::string const & fileName)
+    {
+        neuralNetwork.load(fileName);
+
+        // accumulators computed with previous weights must not serve as a base for updates
+        for(auto & accumulator : accumulatorAtDepth)
+        {
+            accumulator.computed = false;
+        }
+    }
+
+    void Position::setUseNeuralNetwork(bool const useNetwork)
+    {
+        if(useNetwork && !neuralNetwork.isLoaded())
+        {
+            throw std::runtime_error("no network loaded, set EvalFile first");
+        }
+        useNeuralNetwork = useNetwork;
+    }
+
+    void Position::setPerftHashTableSize(unsigned int const megaByte)
+    {
+        perftTable = megaByte ? std::make_shared<PerftTable>(MB * static_cast<size_t>(megaByte)) : nullptr;
+    }
+
+    void Position::setPerftThreads(unsigned int const threads)
+    {
+        if(threads == 0)
+        {
+            throw std::runtime_error("perft needs at least one thread");
+        }
+        perftThreads = threads;
+    }
+
+    void Position::setUseOpeningBook(bool const useBook)
+    {
+        useOpeningBook = useBook;
+    }
+
     void Position::clearHashTable()
     {
         transpositionTable.clear();
     }
 
+    void Position::prepareSearch()
+    {
+        interruptState = Busy;
+    }
+
     void Position::interrupt()
     {
-        if(interruptState == Busy)
         {
-            interruptState = Interrupted;
+            // under ponderMutex, so that a ponder search holding bestmove back cannot miss it
+            std::lock_guard<std::mutex> lock(ponderMutex);
+            auto busy = Busy;
+            interruptState.compare_exchange_strong(busy, Interrupted);
         }
+        ponderCondition.notify_one();
+    }
+
+    void Position::ponder()
+    {
+        std::lock_guard<std::mutex> lock(ponderMutex);
+        pondering = true;
+    }
 
-        while(interruptState!=Idle)
+    void Position::ponderhit()
+    {
         {
-            std::this_thread::sleep_for(INTERRUPT_INTERVAL);
-        };
+            std::lock_guard<std::mutex> lock(ponderMutex);
+            if(!pondering)
+            {
+                return;
+            }
+            pondering = false;
+
+            // without an allocation, the search has either no time limit or not started yet
+            // (it will start the clock itself then)
+            if(ponderTimeAllocation != TimePoint::duration::max())
+            {
+                ponderHitTargetTimePoint = std::chrono::steady_clock::now() + ponderTimeAllocation;
+                deadlineTimer.setDeadline(ponderHitTargetTimePoint);
+            }
+        }
+        ponderCondition.notify_one();
     }
 
     std::string Position::getZKey() const
@@ -389,9 +622,64 @@ namespace spezi
         return "0x" + hexRepresentation.str();
     }
 
+    std::string Position::getFen() const
+    {
+        char constexpr pieceTags[] = "PNBRQKpnbrqk";
+        std::string result;
+
+        for(auto rank = SquaresPerFile - 1; rank >= 0; --rank)
+        {
+            auto emptyFiles = 0;
+            for(auto file = 0; file < SquaresPerRank; ++file)
+            {
+                auto const piece = pieceOn[rank * SquaresPerRank + file];
+                if(piece == NO_PIECE)
+                {
+                    ++emptyFiles;
+                    continue;
+                }
+                if(emptyFiles)
+                {
+                    result += std::to_string(emptyFiles);
+                    emptyFiles = 0;
+                }
+                result += pieceTags[piece];
+            }
+            if(emptyFiles)
+            {
+                result += std::to_string(emptyFiles);
+            }
+            result += rank ? "/" : "";
+        }
+
+        result += sideToMove == WHITE ? " w " : " b ";
+
+        for(auto flag = 0; flag < 4; ++flag)
+        {
+            if(castlingRights & (1 << flag))
+            {
+                result += "KQkq"[flag];
+            }
+        }
+        result += castlingRights & 0xF ? " " : "- ";
+
+        if(enPassant)
+        {
+            auto const square = ffs(enPassant);
+            result += static_cast<char>('a' + square % SquaresPerRank);
+            result += static_cast<char>('1' + square / SquaresPerRank);
+        }
+        else
+        {
+            result += "-";
+        }
+
+        return result + " " + std::to_string(halfMoves) + " " + std::to_string(fullMoves);
+    }
+
     std::string Position::getBoardDisplay(int const indent) const
     {
-        auto const board = pieceBoard(empty, allPieces, individualPieces);
+        auto const board = pieceBoard(*this);
         
         char const p[] = {'*', 'N', 'B', 'R', 'Q', 'K','+', 'n', 'b', 'r', 'q', 'k', '.', 'E'};         
         char const v = '|'; char const h = '-';
@@ -424,50 +712,45 @@ namespace spezi
 
     std::string Position::getPrincipalVariationII() const
     {
-        int depth = 0;
+        // do not show quiescence moves if not mating
+        auto const mating = searchStack[0].alphaBeta[sideToMove] / MaxExpectedMobility != 0;
+        auto const length = mating ? principalVariationLength[0] : std::min<int>(principalVariationLength[0], maxDepth);
+        LineReplay line {pieceOn, zKey, sideToMove, castlingRights, enPassant};
         std::string result = "";
 
-        while(true)
+        for(auto depth = 0; depth < length; ++depth)
         {
-            auto const entry = principalVariation[depth];
-        
-            auto const score = entry.value<MilliSquare, HashEntry::SCORE_MASK>();
-            auto const draft = entry.value<int, HashEntry::DRAFT_MASK>();
+            auto const move = principalVariation[depth];
 
-            if((score / MateValue == 1) ||
-                (depth == MAX_DEPTH_ARRAY_SIZE) || (score / MaxExpectedMobility == 0 && draft <= 0))
-            {
-                break;
-            }
- 
-            auto const move = entry.getUciNotation();
-            if(move == "a1a1 ")
+            // the line is only as good as the hash table agrees with it:
+            // stop where the stored best move of the position differs
+            auto const entry = transpositionTable.get(line.key);
+            if(entry.zKey == line.key && entry.value<Move, HashEntry::MOVE_MASK>() != move)
             {
-                // needs work :)
                 break;
             }
 
-            result += entry.getUciNotation() + " "; 
-            ++depth;
+            result += move.getUciNotation() + " "; 
+            line.play(move);
         }
         return result;
     }
 
     std::string Position::getPrincipalVariation() const
     {
-        auto entry = principalVariationTable.get(zKey);
-        auto key = zKey;
-        auto side = sideToMove;
+        LineReplay line {pieceOn, zKey, sideToMove, castlingRights, enPassant};
+        auto entry = principalVariationTable.get(line.key);
         std::string result = "";
 
         auto counter = 0;
 
-        while(entry.zKey == key)
+        while(entry.zKey == line.key)
         {
             auto const score = entry.value<MilliSquare, HashEntry::SCORE_MASK>();
             auto const draft = entry.value<int, HashEntry::DRAFT_MASK>();
+            auto const move = entry.value<Move, HashEntry::MOVE_MASK>();
 
-            if(score / MateValue == 1   // do not show terminal (illegal) position   
+            if(move.isNull()            // do not show terminal (illegal) position   
                 || (score / MaxExpectedMobility == 0 && draft < 0)
                 || ++counter > 100      // do not show quiescence moves if not mating
             )
@@ -475,77 +758,25 @@ namespace spezi
                 break;
             }
 
-            auto const tentativeMove = entry.getLongAlgebraicNotation() + "at depth " + 
+            auto const origin = move.origin();
+            auto const target = move.target();
+            auto const movedPiece = static_cast<Piece>(line.board[origin] % NumberOfPieceTypes);
+            auto const placedPiece = move.type() == Move::PROMOTION ? move.promoted() : movedPiece;
+            auto const capturedSquare = move.type() == Move::EN_PASSANT ? 
+                target + ((line.side << 1) - 1) * SquaresPerRank : target;
+            auto const capture = line.board[capturedSquare] != NO_PIECE;
+
+            auto const uciNotation = move.getUciNotation();
+            auto const longAlgebraicNotation = move.type() == Move::CASTLING ? 
+                (target > origin ? "0-0" : "0-0-0")
+                : PieceTags[movedPiece] + uciNotation.substr(0, 2) + (capture ? "x" : "-") + uciNotation.substr(2, 2)
+                    + (move.type() == Move::PROMOTION ? PieceTags[placedPiece] : "");
+
+            result += longAlgebraicNotation + " at depth " + 
                 std::to_string(draft) + " with score " + std::to_string(score) + "\n";
-                result += tentativeMove;
-       
-            auto const movedPiece = entry.value<Piece, HashEntry::MOVED_PIECE_MASK>();
-            auto const capturedPiece = entry.value<Piece, HashEntry::CAPTURED_PIECE_MASK>();
-            auto const promotedPiece = entry.value<Piece, HashEntry::PROMOTED_PIECE_MASK>();
-            auto const origin = entry.value<Square, HashEntry::ORIGIN_SQUARE_MASK>();
-            auto const target = entry.value<Square, HashEntry::TARGET_SQUARE_MASK>();
-            auto const epBefore = entry.value<BitBoard, HashEntry::EN_PASSANT_BEFORE_MASK>();
-            auto const epAfter = entry.value<BitBoard, HashEntry::EN_PASSANT_AFTER_MASK>();
-            auto const castlingBefore = entry.value<unsigned char, HashEntry::CASTLING_BEFORE_MASK>();
-            auto const castlingUpdate = entry.value<unsigned char, HashEntry::CASTLING_UPDATE_MASK>();
-
-            key ^= BlackToMoveKey;
-            key ^= PieceKeys[side][movedPiece][origin];
-
-            if(promotedPiece != KING)
-            {
-                key ^= PieceKeys[side][promotedPiece][target];
-            }
-            else
-            {
-                key ^= PieceKeys[side][movedPiece][target];
-            }
-
-            if(capturedPiece != KING)
-            {
-                if(epBefore && target == ffs(epBefore))
-                {
-                    auto const pawn = target + ((side << 1) - 1) * SquaresPerRank;
-                    key ^= PieceKeys[(side + 1) % 2][capturedPiece][pawn];
-                }
-                else
-                {
-                    key ^= PieceKeys[(side + 1) % 2][capturedPiece][target];
-                }
-            }
-            
-            if(movedPiece == KING)
-            {
-                if(origin == e1 && target == g1)
-                {
-                    key ^= PieceKeys[side][ROOK][h1];
-                    key ^= PieceKeys[side][ROOK][f1];
-                }
-                if(origin == e1 && target == c1)
-                {
-                    key ^= PieceKeys[side][ROOK][a1];
-                    key ^= PieceKeys[side][ROOK][d1];
-                }
-                if(origin == e8 && target == g8)
-                {
-                    key ^= PieceKeys[side][ROOK][h8];
-                    key ^= PieceKeys[side][ROOK][f8];
-                }
-                if(origin == e8 && target == c8)
-                {
-                    key ^= PieceKeys[side][ROOK][a8];
-                    key ^= PieceKeys[side][ROOK][d8];
-                }
-            }
-
-            key ^= epBefore ? EnPassantKeys[ffs(epBefore) % SquaresPerRank] : ZKey {0};
-            key ^= epAfter ? EnPassantKeys[ffs(epAfter) % SquaresPerRank] : ZKey {0};
-            key ^= CastlingKeys[castlingBefore];
-            key ^= CastlingKeys[castlingBefore & castlingUpdate];
 
-            side = static_cast<Color>((side + 1) % 2);
-
-            entry = principalVariationTable.get(key);
+            line.play(move);
+            entry = principalVariationTable.get(line.key);
         }
 
         return result;
@@ -570,14 +801,39 @@ namespace spezi
             MilliSeconds{evaluationParameters.movetime},
             fullMoves - 1);
 
-        if(foundPositionInOpeningBook())
+        // a ponder search must not answer from the book, bestmove has to wait for stop or ponderhit
+        auto const ponderSearch = [this]
+        {
+            std::lock_guard<std::mutex> lock(ponderMutex);
+            return pondering;
+        }();
+
+        if(useOpeningBook && !ponderSearch && foundPositionInOpeningBook())
         {
+            interruptState = Idle;
             return EvaluationStatistics{};
         }
 
-        interruptState = Busy;
+        // busy already if prepared by prepareSearch, an interrupt since then stands
+        auto idle = Idle;
+        interruptState.compare_exchange_strong(idle, Busy);
+
+        {
+            // while pondering, the allocated time is kept for ponderhit to start the clock
+            std::lock_guard<std::mutex> lock(ponderMutex);
+            if(pondering)
+            {
+                ponderTimeAllocation = evaluationTargetTimePoint == TimePoint::max() ? TimePoint::duration::max()
+                    : evaluationTargetTimePoint - std::chrono::steady_clock::now();
+                evaluationTargetTimePoint = TimePoint::max();
+            }
+            // also if ponderhit came in since ponderSearch was read
+            ponderHitTargetTimePoint = evaluationTargetTimePoint;
+            deadlineTimer.setDeadline(evaluationTargetTimePoint);
+        }
 
         EvaluationStatistics result;
+        int64_t totalNumberOfNodes = 0;
         std::string bestMovePonderString;
         std::string infoString;
 
@@ -600,16 +856,22 @@ namespace spezi
             auto const start = std::chrono::steady_clock::now();
             maxDepth = currentMaxDepth;
 
-            alphaBetaAtDepth = {};
-            alphaBetaAtDepth[WHITE][0] = LOSS[WHITE];   // initial alpha
-            alphaBetaAtDepth[BLACK][0] = LOSS[BLACK];   // initial beta
-            numberOfNodesAtDepth = {};
+            searchStack = {};
+            searchStack[0].alphaBeta[WHITE] = LOSS[WHITE];   // initial alpha
+            searchStack[0].alphaBeta[BLACK] = LOSS[BLACK];   // initial beta
 
             // simulate starting from an earlier position to accomodate color switching in evaluate()
             sideToMove = static_cast<Color>(sideToMove ^ BLACK);
             fullMoves -= sideToMove;
             zKey^= BlackToMoveKey;
-            evaluate(0);
+            if(evaluationParameters.perft)
+            {
+                evaluate<PERFT_SEARCH>(0);
+            }
+            else
+            {
+                evaluate<MAIN_SEARCH>(0);
+            }
             // revert simulation of earlier position
             zKey^= BlackToMoveKey;
             fullMoves += sideToMove;
@@ -619,25 +881,27 @@ namespace spezi
             int64_t numberOfQuiescenceNodes = 0;
             auto maximumReachedDepth = 0;
 
-            if(interruptState == Interrupted)
-            {
-                break;
-            }
-
             for(auto d = 0; d < MAX_DEPTH + MAX_QUIESCENCE_DEPTH; ++d)
             {
-                if(!numberOfNodesAtDepth[d])
+                if(!searchStack[d].numberOfNodes)
                 {
                     break;
                 }
                 
                 if(d >= currentMaxDepth)
                 {
-                    numberOfQuiescenceNodes += numberOfNodesAtDepth[d];
+                    numberOfQuiescenceNodes += searchStack[d].numberOfNodes;
                 }
                     
                 maximumReachedDepth = d;
-                numberOfNodes += numberOfNodesAtDepth[d];
+                numberOfNodes += searchStack[d].numberOfNodes;
+            }
+            totalNumberOfNodes += numberOfNodes;
+
+            // depth 1 is never aborted, so its result stands
+            if(interruptState == Interrupted && currentMaxDepth > 1)
+            {
+                break;
             }
 
             auto const stop = std::chrono::steady_clock::now();
@@ -645,7 +909,7 @@ namespace spezi
 
             result = 
             {
-                alphaBetaAtDepth[sideToMove][0],
+                searchStack[0].alphaBeta[sideToMove],
                 currentMaxDepth,
                 maximumReachedDepth,
                 numberOfNodes,
@@ -661,18 +925,38 @@ namespace spezi
                             + " time " + std::to_string(static_cast<int>(result.seconds * 1000))
                             + (suppressFaultyPv ? "" : " pv " + getPrincipalVariationII());
             engineToGuiOutputFunction(infoString);                
-            bestMovePonderString = "bestmove " + principalVariation[0].getUciNotation() + " ponder " + principalVariation[1].getUciNotation();
+            bestMovePonderString = "bestmove " + principalVariation[0].getUciNotation() 
+                + (principalVariationLength[0] < 2 ? "" : " ponder " + principalVariation[1].getUciNotation());
 
-            if(result.evaluation > MaxExpectedMobility || result.evaluation < -MaxExpectedMobility)
+            if(!evaluationParameters.perft
+                && (result.evaluation > MaxExpectedMobility || result.evaluation < -MaxExpectedMobility))
             {
                 break;
             }
 
+            if(ponderSearch)
+            {
+                std::lock_guard<std::mutex> lock(ponderMutex);
+                evaluationTargetTimePoint = ponderHitTargetTimePoint;
+            }
+
             if(!enoughTimeForDeeperSearch(evaluationTargetTimePoint, duration))
             {
                 break;
             }
         }
+        result.totalNumberOfNodes = totalNumberOfNodes;
+
+        {
+            // a ponder search that is done early holds bestmove back until stop or ponderhit
+            std::unique_lock<std::mutex> lock(ponderMutex);
+            ponderCondition.wait(lock, [this]{ return !pondering || interruptState == Interrupted; });
+            pondering = false;
+            ponderTimeAllocation = TimePoint::duration::max();
+        }
+
+        // stop the timer before reporting, the next search may start right after
+        deadlineTimer.cancel();
 
         // send last info string for full search again,
         // send bestmove ponder string   
@@ -698,80 +982,275 @@ namespace spezi
         return result;
     }   
 
-    void Position::evaluate(int const depth)
-    {  
-        if(maxDepth > 1 && checkAbortingConditions())
+    int64_t Position::perft(int const depth, bool const divide)
+    {
+        if(depth < 1 || depth > MAX_DEPTH)
         {
-            // do not abort for maxDepth 1 - we need to report a best move
-            // in order to satisfy UCI - rather lose on time
-            return;
+            throw std::runtime_error("perft depth must be between 1 and " + std::to_string(MAX_DEPTH));
         }
 
-        auto const nodesAtEntry = numberOfNodesAtDepth[depth + 1];   
-        ++numberOfNodesAtDepth[depth];
-
-        auto const quiescence = depth >= maxDepth;
-        auto const other = sideToMove;
-
-        fullMoves += sideToMove;
-        sideToMove = static_cast<Color>(sideToMove ^ BLACK);
-        zKey ^= BlackToMoveKey;
+        auto const start = std::chrono::steady_clock::now();
+        auto idle = Idle;
+        interruptState.compare_exchange_strong(idle, Busy);
+        evaluationTargetTimePoint = TimePoint::max();
+        perftShortcuts = true;
 
-#ifndef PERFT
-        // make early exit checks (repetition, transposition, legality) from least to most expensive
-        if(repetition())
+        if(perftThreads == 1 || depth == 1)
         {
-            alphaBetaAtDepth[sideToMove][depth] = DRAW;
-            hashEntryAtDepth[depth] = HashEntry(PV_NODE, zKey, maxDepth - depth, DRAW);
-            storePrincipalVariation(hashEntryAtDepth[depth], depth);
-            goto exit;
+            countLeafNodes(depth);
         }
+        else
+        {
+            // split the root moves: each thread takes the next root move not taken yet
+            // and counts its subtree on a copy of the position
+            countLeafNodes(1);
+            auto const fen = getFen();
+            auto const numberOfThreads = std::min<size_t>(perftThreads, perftRootMoves.size());
+            std::atomic<size_t> nextRootMove {0};
+            std::atomic<size_t> finishedThreads {0};
+            std::vector<std::unique_ptr<Position>> workers;
+            std::vector<std::thread> threads;
+
+            for(size_t i = 0; i < numberOfThreads; ++i)
+            {
+                workers.push_back(std::make_unique<Position>(fen, [](std::string){}));
+                auto & worker = *workers.back();
+                worker.interruptState = Busy;
+                worker.evaluationTargetTimePoint = TimePoint::max();
+                worker.perftShortcuts = true;
+                worker.perftTable = perftTable;
+
+                threads.emplace_back([this, &worker, &fen, &nextRootMove, &finishedThreads, depth]
+                {
+                    for(auto index = nextRootMove++; index < perftRootMoves.size(); index = nextRootMove++)
+                    {
+                        worker.setFen(fen);
+                        worker.makeMove(perftRootMoves[index].first.getUciNotation());
+                        perftRootMoves[index].second = worker.countLeafNodes(depth - 1);
+                    }
+                    ++finishedThreads;
+                });
+            }
 
-        // TODO: check 50 move rule here!
+            // pass a stop on to the threads
+            while(finishedThreads < numberOfThreads)
+            {
+                std::this_thread::sleep_for(INTERRUPT_INTERVAL);
+                if(interruptState == Interrupted)
+                {
+                    for(auto & worker : workers)
+                    {
+                        worker->interruptState = Interrupted;
+                    }
+                }
+            }
 
-        if(depth > 0)
-        {
-            alphaBetaAtDepth[WHITE][depth] = absInc(alphaBetaAtDepth[WHITE][depth-1]);
-            alphaBetaAtDepth[BLACK][depth] = absInc(alphaBetaAtDepth[BLACK][depth-1]);
+            for(auto & thread : threads)
+            {
+                thread.join();
+            }
         }
 
-        history[historyIndex(fullMoves, sideToMove)] = zKey;
-
-        hashEntryAtDepth[depth] = {}; 
-        if(!evaluateHashMove(depth))
+        int64_t numberOfNodes = 0;
+        for(auto const & rootMove : perftRootMoves)
         {
-            goto exit;
+            numberOfNodes += rootMove.second;
         }
-#endif
-        if(isAttacked(sideToMove, ffs(allPieces[other] & individualPieces[KING])))
-        {
-            alphaBetaAtDepth[sideToMove][depth] = LOSS[other];
-            --numberOfNodesAtDepth[depth];     // do not count illegal positions
-            goto exit;
-        }        
 
-#ifdef PERFT
-        if(quiescence)
+        if(divide)
         {
-            goto exit;
+            auto rootMoves = perftRootMoves;
+            std::sort(rootMoves.begin(), rootMoves.end(), [](auto const & a, auto const & b)
+            {
+                return a.first.getUciNotation() < b.first.getUciNotation();
+            });
+            for(auto const & rootMove : rootMoves)
+            {
+                engineToGuiOutputFunction(rootMove.first.getUciNotation() + ": " + std::to_string(rootMove.second));
+            }
         }
-#endif
 
-        if(quiescence)
-        {
-            auto const inCheck = isAttacked(other, ffs(allPieces[sideToMove] & individualPieces[KING]));
-            auto const score = evaluateStatically();//*/pawnUnitsOnBoard();
-           
-            alphaBetaAtDepth[sideToMove][depth] = score;
+        auto const milliSeconds = std::chrono::duration_cast<MilliSeconds>(std::chrono::steady_clock::now() - start).count();
+        engineToGuiOutputFunction("info depth " + std::to_string(depth)
+            + " nodes " + std::to_string(numberOfNodes)
+            + " time " + std::to_string(milliSeconds)
+            + " nps " + std::to_string(numberOfNodes * 1000 / std::max<int64_t>(milliSeconds, 1)));
 
-            if(!inCheck)
-            {
-                // never cut or terminate quiescence search if we are in check
-                auto const sign = (other << 1) - 1;
-                if(sign * score >= sign * alphaBetaAtDepth[other][depth])
-                {
-                    // beta cutoff;
-                    alphaBetaAtDepth[sideToMove][depth] = alphaBetaAtDepth[other][depth];
+        perftShortcuts = false;
+        interruptState = Idle;
+
+        return numberOfNodes;
+    }
+
+    std::vector<Move> Position::legalMoves()
+    {
+        perftShortcuts = true;
+        countLeafNodes(1);
+        perftShortcuts = false;
+
+        std::vector<Move> moves;
+        for(auto const & rootMove : perftRootMoves)
+        {
+            moves.push_back(rootMove.first);
+        }
+        return moves;
+    }
+
+    int64_t Position::countLeafNodes(int const depth)
+    {
+        perftRootMoves.clear();
+        maxDepth = depth;
+        searchStack = {};
+
+        // simulate starting from an earlier position to accomodate color switching in evaluate()
+        sideToMove = static_cast<Color>(sideToMove ^ BLACK);
+        fullMoves -= sideToMove;
+        zKey ^= BlackToMoveKey;
+        evaluate<PERFT_SEARCH>(0);
+        // revert simulation of earlier position
+        zKey ^= BlackToMoveKey;
+        fullMoves += sideToMove;
+        sideToMove = static_cast<Color>(sideToMove ^ BLACK);
+
+        return searchStack[depth].numberOfNodes;
+    }
+
+    template<SearchType searchType>
+    void Position::evaluate(int const depth)
+    {  
+        if constexpr(searchType == MAIN_SEARCH)
+        {
+            // the main search turns into quiescence search at the horizon
+            if(depth >= maxDepth)
+            {
+                evaluate<QUIESCENCE_SEARCH>(depth);
+                return;
+            }
+        }
+
+        if(maxDepth > 1 && checkAbortingConditions())
+        {
+            // do not abort for maxDepth 1 - we need to report a best move
+            // in order to satisfy UCI - rather lose on time
+            return;
+        }
+
+        auto const nodesAtEntry = searchStack[depth + 1].numberOfNodes;   
+        ++searchStack[depth].numberOfNodes;
+
+        auto const other = sideToMove;
+
+        fullMoves += sideToMove;
+        sideToMove = static_cast<Color>(sideToMove ^ BLACK);
+        zKey ^= BlackToMoveKey;
+
+        attackMapsAtDepth[depth].valid = 0;
+
+        if constexpr(searchType != PERFT_SEARCH)
+        {
+            // the line of this node is filled by moves raising alpha, terminal nodes keep it empty
+            principalVariationLength[depth] = 0;
+
+            // make early exit checks (repetition, transposition, legality) from least to most expensive
+            if(repetition())
+            {
+                searchStack[depth].alphaBeta[sideToMove] = DRAW;
+                searchStack[depth].hashEntry = HashEntry(PV_NODE, zKey, maxDepth - depth, DRAW);
+                goto exit;
+            }
+
+            // TODO: check 50 move rule here!
+
+            if(depth > 0)
+            {
+                searchStack[depth].alphaBeta[WHITE] = absInc(searchStack[depth-1].alphaBeta[WHITE]);
+                searchStack[depth].alphaBeta[BLACK] = absInc(searchStack[depth-1].alphaBeta[BLACK]);
+            }
+
+            history[historyIndex(fullMoves, sideToMove)] = zKey;
+
+            searchStack[depth].hashEntry = {}; 
+            if(!evaluateHashMove<searchType>(depth))
+            {
+                goto exit;
+            }
+        }
+
+        // moves are generated legally, so only the root position (as set up by the GUI)
+        // can leave the side that just moved in check
+        if(depth == 0 && isAttacked(sideToMove, ffs(piecesOf(other, KING))))
+        {
+            searchStack[depth].alphaBeta[sideToMove] = LOSS[other];
+            --searchStack[depth].numberOfNodes;     // do not count illegal positions
+            goto exit;
+        }        
+
+        if constexpr(searchType == PERFT_SEARCH)
+        {
+            // nodes at the horizon are counted, but not expanded
+            if(depth >= maxDepth)
+            {
+                goto exit;
+            }
+
+            if(perftShortcuts && perftTable && depth > 0 && maxDepth - depth > 1)
+            {
+                int64_t numberOfNodes;
+                if(perftTable->get(zKey, maxDepth - depth, numberOfNodes))
+                {
+                    searchStack[maxDepth].numberOfNodes += numberOfNodes;
+                    goto exit;
+                }
+            }
+        }
+
+        // everything below (evasions, pruning guards, mate and stalemate detection) 
+        // asks for the checkers, so they are found once here
+        searchStack[depth].checkers = attackersTo(other, ffs(piecesOf(sideToMove, KING)));
+
+        if constexpr(searchType == PERFT_SEARCH)
+        {
+            if(perftShortcuts && depth > 0)
+            {
+                // bulk counting: the leaves below are counted, not entered
+                // (the root is always expanded to count the nodes per root move)
+                if(depth + 1 == maxDepth)
+                {
+                    searchStack[maxDepth].numberOfNodes += 
+                        sideToMove == WHITE ? countLegalMoves<WHITE>(depth) : countLegalMoves<BLACK>(depth);
+                    goto exit;
+                }
+
+                auto const leavesAtEntry = searchStack[maxDepth].numberOfNodes;
+                evaluateCaptures<PERFT_SEARCH>(depth);
+                evaluateNonCaptures<PERFT_SEARCH>(depth);
+                // an interrupted subtree is incomplete
+                if(perftTable && interruptState != Interrupted)
+                {
+                    perftTable->insert(zKey, maxDepth - depth, searchStack[maxDepth].numberOfNodes - leavesAtEntry);
+                }
+                goto exit;
+            }
+
+            evaluateCaptures<PERFT_SEARCH>(depth);
+            evaluateNonCaptures<PERFT_SEARCH>(depth);
+            goto exit;
+        }
+        else if constexpr(searchType == QUIESCENCE_SEARCH)
+        {
+            auto const inCheck = searchStack[depth].checkers != EMPTY;
+            auto const score = useNeuralNetwork ? evaluateNeuralNetwork(depth) : evaluateStatically(attackMapsAtDepth[depth]);//*/pawnUnitsOnBoard();
+           
+            searchStack[depth].alphaBeta[sideToMove] = score;
+
+            if(!inCheck)
+            {
+                // never cut or terminate quiescence search if we are in check
+                auto const sign = (other << 1) - 1;
+                if(sign * score >= sign * searchStack[depth].alphaBeta[other])
+                {
+                    // beta cutoff;
+                    searchStack[depth].alphaBeta[sideToMove] = searchStack[depth].alphaBeta[other];
                     goto exit;
                 }
                 if(depth - maxDepth == maxQuiescenceDepth)
@@ -780,15 +1259,15 @@ namespace spezi
                 }
             }
 
-            if(evaluateCaptures(depth)  // captures did not produce beta cutoff and
-                && numberOfNodesAtDepth[depth + 1] == nodesAtEntry // no legal captures
+            if(evaluateCaptures<searchType>(depth)  // captures did not produce beta cutoff and
+                && searchStack[depth + 1].numberOfNodes == nodesAtEntry // no legal captures
                 && inCheck)
             {
                 // proceed with evaluation of non-captures to evade checks
                 // first, reset current alpha to MateValue (otherwise program will believe
                 // there already is a move with the static evaluation, which is not true) 
-                alphaBetaAtDepth[sideToMove][depth] = LOSS[sideToMove];
-                evaluateNonCaptures(depth);
+                searchStack[depth].alphaBeta[sideToMove] = LOSS[sideToMove];
+                evaluateNonCaptures<searchType>(depth);
             }
         }
         else
@@ -798,41 +1277,41 @@ namespace spezi
             nullMoveDepth = 0;
 
             if(noNullMoveCutoff  // null move did not produce beta cutoff
-                && evaluateCaptures(depth) // captures did not produce beta cutoff and              
-                && evaluateNonCaptures(depth) // normal moves did not produce beta cutoff
-                && numberOfNodesAtDepth[depth + 1] == nodesAtEntry) // no legal moves / captures
+                && evaluateCaptures<searchType>(depth) // captures did not produce beta cutoff and              
+                && evaluateNonCaptures<searchType>(depth) // normal moves did not produce beta cutoff
+                && searchStack[depth + 1].numberOfNodes == nodesAtEntry) // no legal moves / captures
             {
-                if(!isAttacked(other, ffs(allPieces[sideToMove] & individualPieces[KING])))
+                if(!searchStack[depth].checkers)
                 {
-                    alphaBetaAtDepth[sideToMove][depth] = DRAW;
-                    hashEntryAtDepth[depth] = HashEntry(PV_NODE, zKey, maxDepth - depth, DRAW); 
+                    searchStack[depth].alphaBeta[sideToMove] = DRAW;
+                    searchStack[depth].hashEntry = HashEntry(PV_NODE, zKey, maxDepth - depth, DRAW); 
                 }
                 else
                 {
                     // TODO: brauch ich das wirklich hier (wg. null move?) vielleicht nur die zweite Zeile?
-                    alphaBetaAtDepth[sideToMove][depth] = LOSS[sideToMove];
-                    hashEntryAtDepth[depth] = HashEntry(PV_NODE, zKey, maxDepth - depth, LOSS[sideToMove]); 
+                    searchStack[depth].alphaBeta[sideToMove] = LOSS[sideToMove];
+                    searchStack[depth].hashEntry = HashEntry(PV_NODE, zKey, maxDepth - depth, LOSS[sideToMove]); 
                 }
             }
 
             nullMoveDepth = originalNullMoveDepth;
         }
 
-    switch(hashEntryAtDepth[depth].value<HashEntryType, HashEntry::TYPE_MASK>())
+    switch(searchStack[depth].hashEntry.value<HashEntryType, HashEntry::TYPE_MASK>())
     {
         case CUT_NODE:
-            transpositionTable.insert(hashEntryAtDepth[depth]);
+            transpositionTable.insert(searchStack[depth].hashEntry);
             ++cutEntries;
             break;
         case ALL_NODE:
             ++allEntries;
             break;
         case PV_NODE:
-            transpositionTable.insert(hashEntryAtDepth[depth]);
+            transpositionTable.insert(searchStack[depth].hashEntry);
             ++exactEntries;
          /*   if(!quiescence)
             {
-                if(principalVariationTable.insert(hashEntryAtDepth[depth]))
+                if(principalVariationTable.insert(searchStack[depth].hashEntry))
                 {
                     ++pvEntries;
                 }
@@ -841,10 +1320,6 @@ namespace spezi
                     ++pvMisses;
                 }
             }*/
-            if(!nullMovesOnBranch)
-            {
-                storePrincipalVariation(hashEntryAtDepth[depth], depth);
-            }
             break;
     }
 
@@ -876,39 +1351,146 @@ namespace spezi
 
     bool Position::isAttacked(Color const attacking, Square const square)
     {
-        return (PawnAttacks[attacking ^ BLACK][square] & allPieces[attacking] & individualPieces[PAWN])
-            || (KnightAttacks[square] & allPieces[attacking] & individualPieces[KNIGHT])
-            || (DiagonalAttacks[square][pext(~empty,DiagonalMasks[square])] & allPieces[attacking]
-                & (individualPieces[BISHOP] | individualPieces[QUEEN]))
-            || (RankAttacks[square][pext(~empty, RankMasks[square])] & allPieces[attacking]
-                & (individualPieces[ROOK] | individualPieces[QUEEN]))
-            || (FileAttacks[square][pext(~empty, FileMasks[square])] & allPieces[attacking]
-                & (individualPieces[ROOK] | individualPieces[QUEEN]))
-            || (KingAttacks[square] & allPieces[attacking] & individualPieces[KING]);
+        return (PawnAttacks[attacking ^ BLACK][square] & piecesOf(attacking, PAWN))
+            || (KnightAttacks[square] & piecesOf(attacking, KNIGHT))
+            || (bishopAttacks(square, ~emptySquares()) & piecesOf(attacking) & diagonalSliders())
+            || (rookAttacks(square, ~emptySquares()) & piecesOf(attacking) & orthogonalSliders())
+            || (KingAttacks[square] & piecesOf(attacking, KING));
     }   
 
+    // mailbox and piece list maintenance only, the callers update the bitboards
+    inline void Position::putPiece(Color const color, Piece const piece, Square const square)
+    {
+        pieceOn[square] = color * NumberOfPieceTypes + piece;
+        pieceIndex[square] = pieceCount[color];
+        pieceList[color][pieceCount[color]++] = square;
+    }
+
+    inline void Position::removePiece(Square const square)
+    {
+        auto const color = pieceOn[square] / NumberOfPieceTypes;
+        auto const last = pieceList[color][--pieceCount[color]];
+        pieceList[color][pieceIndex[square]] = last;
+        pieceIndex[last] = pieceIndex[square];
+        pieceOn[square] = NO_PIECE;
+    }
+
+    inline void Position::movePiece(Square const origin, Square const target)
+    {
+        pieceOn[target] = pieceOn[origin];
+        pieceOn[origin] = NO_PIECE;
+        pieceIndex[target] = pieceIndex[origin];
+        pieceList[pieceOn[target] / NumberOfPieceTypes][pieceIndex[target]] = target;
+    }
+
+    BitBoard Position::attackersTo(Color const attacking, Square const square) const
+    {
+        return piecesOf(attacking) & 
+            ((PawnAttacks[attacking ^ BLACK][square] & piecesOfType(PAWN))
+            | (KnightAttacks[square] & piecesOfType(KNIGHT))
+            | (bishopAttacks(square, ~emptySquares()) & diagonalSliders())
+            | (rookAttacks(square, ~emptySquares()) & orthogonalSliders())
+            | (KingAttacks[square] & piecesOfType(KING)));
+    }
+
+    void Position::computeAttackMaps(AttackMaps & attackMaps, Color const side) const
+    {
+        auto const other = static_cast<Color>(side ^ BLACK);
+        auto const occupied = ~emptySquares();
+        auto const own = piecesOf(side);
+        auto const enemyPawns = piecesOf(other, PAWN);
+        auto & byPiece = attackMaps.byPiece[side];
+        auto & safeMobility = attackMaps.safeMobility[side];
+
+        BitBoard enemyPawnAttacks;
+        if(side == WHITE)
+        {
+            byPiece[PAWN] = pawnAttackSet<WHITE>(own & piecesOfType(PAWN));
+            enemyPawnAttacks = pawnAttackSet<BLACK>(enemyPawns);
+        }
+        else
+        {
+            byPiece[PAWN] = pawnAttackSet<BLACK>(own & piecesOfType(PAWN));
+            enemyPawnAttacks = pawnAttackSet<WHITE>(enemyPawns);
+        }
+
+        auto const safe = ~own & ~enemyPawnAttacks;
+        safeMobility = 0;
+        byPiece[KNIGHT] = pieceAttacks<KNIGHT>(own & piecesOfType(KNIGHT), occupied, safe, safeMobility);
+        byPiece[BISHOP] = pieceAttacks<BISHOP>(own & piecesOfType(BISHOP), occupied, safe, safeMobility);
+        byPiece[ROOK] = pieceAttacks<ROOK>(own & piecesOfType(ROOK), occupied, safe, safeMobility);
+        byPiece[QUEEN] = pieceAttacks<QUEEN>(own & piecesOfType(QUEEN), occupied, safe, safeMobility);
+        byPiece[KING] = KingAttacks[ffs(own & piecesOfType(KING))];
+
+        attackMaps.bySide[side] = byPiece[PAWN] | byPiece[KNIGHT] | byPiece[BISHOP] 
+            | byPiece[ROOK] | byPiece[QUEEN] | byPiece[KING];
+        attackMaps.valid |= 1 << side;
+    }
+
+    BitBoard Position::attackedBy(AttackMaps & attackMaps, Color const side) const
+    {
+        if(!(attackMaps.valid & (1 << side)))
+        {
+            computeAttackMaps(attackMaps, side);
+        }
+        return attackMaps.bySide[side];
+    }
+
+    AttackMaps const & Position::pinsAndEvasions(int const depth)
+    {
+        auto & attackMaps = attackMapsAtDepth[depth];
+        if(!(attackMaps.valid & AttackMaps::PINS))
+        {
+            auto const other = static_cast<Color>(sideToMove ^ BLACK);
+            auto const king = ffs(piecesOf(sideToMove, KING));
+            auto const checking = searchStack[depth].checkers;
+
+            // single check: capture the checker or block the line to the king
+            attackMaps.evasions = !checking ? ~EMPTY
+                : (checking & (checking - 1)) ? EMPTY
+                : checking | Between[king][ffs(checking)];
+
+            attackMaps.pinned = EMPTY;
+            auto snipers = piecesOf(other)
+                & ((RanksAndFiles[king] & orthogonalSliders())
+                | (Diagonals[king] & diagonalSliders()));
+            while(snipers)
+            {
+                auto const blockers = Between[king][ffs(snipers)] & ~emptySquares();
+                if(blockers && !(blockers & (blockers - 1)))
+                {
+                    attackMaps.pinned |= blockers & piecesOf(sideToMove);
+                }
+                snipers &= snipers - 1;
+            }
+
+            attackMaps.valid |= AttackMaps::PINS;
+        }
+        return attackMaps;
+    }
+
     MilliSquare Position::pawnUnitsOnBoard() const
     {
         auto const whitePieces =
-            popcount(allPieces[WHITE] & individualPieces[QUEEN]) * 9 +
-            popcount(allPieces[WHITE] & individualPieces[ROOK]) * 5 +
-            popcount(allPieces[WHITE] & (individualPieces[BISHOP] | individualPieces[KNIGHT])) * 3 +
-            popcount(allPieces[WHITE] & individualPieces[PAWN]);
+            popcount(piecesOf(WHITE, QUEEN)) * 9 +
+            popcount(piecesOf(WHITE, ROOK)) * 5 +
+            popcount(piecesOf(WHITE) & (piecesOfType(BISHOP) | piecesOfType(KNIGHT))) * 3 +
+            popcount(piecesOf(WHITE, PAWN));
 
         auto const blackPieces =
-            popcount(allPieces[BLACK] & individualPieces[QUEEN]) * 9 +
-            popcount(allPieces[BLACK] & individualPieces[ROOK]) * 5 +
-            popcount(allPieces[BLACK] & (individualPieces[BISHOP] | individualPieces[KNIGHT])) * 3 +
-            popcount(allPieces[BLACK] & individualPieces[PAWN]);
+            popcount(piecesOf(BLACK, QUEEN)) * 9 +
+            popcount(piecesOf(BLACK, ROOK)) * 5 +
+            popcount(piecesOf(BLACK) & (piecesOfType(BISHOP) | piecesOfType(KNIGHT))) * 3 +
+            popcount(piecesOf(BLACK, PAWN));
 
         auto constexpr center = D4|E4|D5|E5;
         auto constexpr extendedCenter = C3|D3|E3|F3|F4|F5|F6|E6|D6|C6|C5|C4;
 
-        auto const whiteCenter = popcount(allPieces[WHITE] & center); 
-        auto const whiteExtendedCenter = popcount(allPieces[WHITE] & extendedCenter); 
+        auto const whiteCenter = popcount(piecesOf(WHITE) & center); 
+        auto const whiteExtendedCenter = popcount(piecesOf(WHITE) & extendedCenter); 
         
-        auto const blackCenter = popcount(allPieces[BLACK] & center); 
-        auto const blackExtendedCenter = popcount(allPieces[BLACK] & extendedCenter); 
+        auto const blackCenter = popcount(piecesOf(BLACK) & center); 
+        auto const blackExtendedCenter = popcount(piecesOf(BLACK) & extendedCenter); 
         
         return (whitePieces - blackPieces) * PawnUnit + (whiteCenter - blackCenter) * PawnUnit / 3 + (whiteExtendedCenter - blackExtendedCenter) * PawnUnit / 9;
     }
@@ -917,37 +1499,55 @@ namespace spezi
 
     MilliSquare Position::evaluateStatically() const
     {
-        auto const p = populationIndex(popcount(~empty));
+        AttackMaps attackMaps;
+        return evaluateStatically(attackMaps);
+    }
+
+    MilliSquare Position::evaluateStatically(AttackMaps & attackMaps) const
+    {
+        auto const p = populationIndex(popcount(~emptySquares()));
+        auto const & mobilities = PackedStaticMobilities[p];
         
         auto const kingSafetyMultiplier = 16 - p;
 
         // invert king mobility early in the game
-        auto value = (StaticMobilities<WHITE, KING>[ffs(allPieces[WHITE] & individualPieces[KING])][p] >> 4) * kingSafetyMultiplier;
-        value -= (StaticMobilities<BLACK, KING>[ffs(allPieces[BLACK] & individualPieces[KING])][p] >> 4) * kingSafetyMultiplier;
+        auto value = (mobilities[WHITE][KING][ffs(piecesOf(WHITE, KING))] >> 4) * kingSafetyMultiplier;
+        value -= (mobilities[BLACK][KING][ffs(piecesOf(BLACK, KING))] >> 4) * kingSafetyMultiplier;
 
         // do not move the queen out quite so aggressively in the opening
-        auto const whiteQueens = allPieces[WHITE] & individualPieces[QUEEN];
-        auto const blackQueens = allPieces[BLACK] & individualPieces[QUEEN];
-        value += (staticPieceEvaluation<WHITE, QUEEN>(whiteQueens, p) * (64 - p) + (p << 3) * PawnUnit * popcount(whiteQueens)) >> 6;
-        value -= (staticPieceEvaluation<BLACK, QUEEN>(blackQueens, p) * (64 - p) + (p << 3) * PawnUnit * popcount(blackQueens)) >> 6;
+        auto const whiteQueens = piecesOf(WHITE, QUEEN);
+        auto const blackQueens = piecesOf(BLACK, QUEEN);
+        value += (staticPieceEvaluation<WHITE, QUEEN>(whiteQueens, mobilities) * (64 - p) + (p << 3) * PawnUnit * popcount(whiteQueens)) >> 6;
+        value -= (staticPieceEvaluation<BLACK, QUEEN>(blackQueens, mobilities) * (64 - p) + (p << 3) * PawnUnit * popcount(blackQueens)) >> 6;
         
         // rooks are apparently undervalued by static mobilities
-        auto const whiteRooks = allPieces[WHITE] & individualPieces[ROOK];
-        auto const blackRooks = allPieces[BLACK] & individualPieces[ROOK];
-        value += staticPieceEvaluation<WHITE, ROOK>(whiteRooks, p) + (PawnUnit * popcount(whiteRooks) >> 2);
-        value -= staticPieceEvaluation<BLACK, ROOK>(blackRooks, p) + (PawnUnit * popcount(blackRooks) >> 2);
+        auto const whiteRooks = piecesOf(WHITE, ROOK);
+        auto const blackRooks = piecesOf(BLACK, ROOK);
+        value += PawnUnit * popcount(whiteRooks) >> 2;
+        value -= PawnUnit * popcount(blackRooks) >> 2;
+
+        auto const whitePawns = piecesOf(WHITE, PAWN);
+        auto const blackPawns = piecesOf(BLACK, PAWN);
+
+#if defined(GATHER_EVALUATION) && defined(__AVX2__)
+        value += horizontalSum(_mm256_sub_epi32(
+            gatherPieceEvaluation<WHITE>(whitePawns, piecesOf(WHITE, KNIGHT), 
+                piecesOf(WHITE, BISHOP), whiteRooks, mobilities),
+            gatherPieceEvaluation<BLACK>(blackPawns, piecesOf(BLACK, KNIGHT), 
+                piecesOf(BLACK, BISHOP), blackRooks, mobilities)));
+#else
+        value += staticPieceEvaluation<WHITE, ROOK>(whiteRooks, mobilities);
+        value -= staticPieceEvaluation<BLACK, ROOK>(blackRooks, mobilities);
         
-        value += staticPieceEvaluation<WHITE, BISHOP>(allPieces[WHITE] & individualPieces[BISHOP], p);
-        value -= staticPieceEvaluation<BLACK, BISHOP>(allPieces[BLACK] & individualPieces[BISHOP], p);
+        value += staticPieceEvaluation<WHITE, BISHOP>(piecesOf(WHITE, BISHOP), mobilities);
+        value -= staticPieceEvaluation<BLACK, BISHOP>(piecesOf(BLACK, BISHOP), mobilities);
         
-        value += staticPieceEvaluation<WHITE, KNIGHT>(allPieces[WHITE] & individualPieces[KNIGHT], p);
-        value -= staticPieceEvaluation<BLACK, KNIGHT>(allPieces[BLACK] & individualPieces[KNIGHT], p);
-       
-        auto const whitePawns = allPieces[WHITE] & individualPieces[PAWN];
-        auto const blackPawns = allPieces[BLACK] & individualPieces[PAWN];
+        value += staticPieceEvaluation<WHITE, KNIGHT>(piecesOf(WHITE, KNIGHT), mobilities);
+        value -= staticPieceEvaluation<BLACK, KNIGHT>(piecesOf(BLACK, KNIGHT), mobilities);
 
-        value += staticPieceEvaluation<WHITE, PAWN>(whitePawns, p);
-        value -= staticPieceEvaluation<BLACK, PAWN>(blackPawns, p);
+        value += staticPieceEvaluation<WHITE, PAWN>(whitePawns, mobilities);
+        value -= staticPieceEvaluation<BLACK, PAWN>(blackPawns, mobilities);
+#endif
 
         // invest some effort to free both bishops in the opening
         auto constexpr whiteBishopPrison1 = B2 | D2;
@@ -960,6 +1560,15 @@ namespace spezi
         value += (blackBishopPrison1 & blackPawns) == blackBishopPrison1 ? PawnUnit * 3 / 4 : 0; 
         value += (blackBishopPrison2 & blackPawns) == blackBishopPrison2 ? PawnUnit * 3 / 4 : 0; 
 
+        // optionally reward actual (safe) mobility on this board on top of the static averages
+        if(dynamicMobilityWeight)
+        {
+            attackedBy(attackMaps, WHITE);
+            attackedBy(attackMaps, BLACK);
+            auto const safeSquares = attackMaps.safeMobility[WHITE] - attackMaps.safeMobility[BLACK];
+            value += squareToMilli(safeSquares) * dynamicMobilityWeight / 100;
+        }
+
         /*
         // discourage multiple pawn islands and doubled/tripled/etc. pawns
         // auto wN = whitePawns; wN |= (wN <<  8); wN |= (wN << 16); wN |= (wN << 32);
@@ -983,6 +1592,136 @@ namespace spezi
         return value;
     }
 
+    MilliSquare Position::evaluateNeuralNetwork(int const depth)
+    {
+        // the parent ply's accumulator usually differs by the last move only; main search plies
+        // never compute theirs, so fall back to the one left behind by the previous sibling
+        auto & accumulator = accumulatorAtDepth[depth];
+        auto const & parent = accumulatorAtDepth[depth > 0 ? depth - 1 : depth];
+        neuralNetwork.update(accumulator, parent.computed ? parent : accumulator, *this);
+
+        auto const centiPawns = neuralNetwork.evaluate(accumulator, sideToMove);
+        auto const value = std::clamp(centiPawns * PawnUnit / 100, 1 - MaxExpectedMobility, MaxExpectedMobility - 1);
+
+        return sideToMove == WHITE ? value : -value;
+    }
+
+    // make a move of sideToMove (without flipping sides), saving what is needed to take it back
+    void Position::makeMove(Move const move, UndoState & undoState)
+    {
+        auto const other = static_cast<Color>(sideToMove ^ BLACK);
+        auto const origin = move.origin();
+        auto const target = move.target();
+        auto const from = A1 << origin;
+        auto const to = A1 << target;
+
+        auto const movedPiece = static_cast<Piece>(pieceOn[origin] % NumberOfPieceTypes);
+        auto const placedPiece = move.type() == Move::PROMOTION ? move.promoted() : movedPiece;
+        auto const capturedSquare = move.type() == Move::EN_PASSANT ? 
+            target + ((sideToMove << 1) - 1) * SquaresPerRank : target;
+
+#ifdef COPY_MAKE
+        undoState.board = *this;
+#else
+        undoState.zKey = zKey;
+        undoState.enPassant = enPassant;
+        undoState.halfMoves = halfMoves;
+        undoState.castlingRights = castlingRights;
+#endif
+        undoState.captured = pieceOn[capturedSquare] == NO_PIECE ? 
+            KING : static_cast<Piece>(pieceOn[capturedSquare] % NumberOfPieceTypes);
+
+        if(undoState.captured != KING)
+        {
+            zKey ^= PieceKeys[other][undoState.captured][capturedSquare];
+            togglePieces(other, undoState.captured, A1 << capturedSquare);
+            removePiece(capturedSquare);
+            halfMoves = 0;
+        }
+        else
+        {
+            halfMoves += movedPiece == PAWN ? -halfMoves : 1;
+        }
+
+        zKey ^= PieceKeys[sideToMove][movedPiece][origin];
+        zKey ^= PieceKeys[sideToMove][placedPiece][target];
+        togglePieces(sideToMove, movedPiece, from);
+        togglePieces(sideToMove, placedPiece, to);
+        movePiece(origin, target);
+        pieceOn[target] = sideToMove * NumberOfPieceTypes + placedPiece;
+
+        if(move.type() == Move::CASTLING)
+        {
+            // h1 -> f1 or a1 -> d1 (and mirrored)
+            auto const rookOrigin = target > origin ? target + 1 : target - 2;
+            auto const rookTarget = (origin + target) >> 1;
+            togglePieces(sideToMove, ROOK, (A1 << rookOrigin) | (A1 << rookTarget));
+            zKey ^= PieceKeys[sideToMove][ROOK][rookOrigin];
+            zKey ^= PieceKeys[sideToMove][ROOK][rookTarget];
+            movePiece(rookOrigin, rookTarget);
+        }
+
+        zKey ^= enPassant ? EnPassantKeys[ffs(enPassant) % SquaresPerRank] : ZKey {0};
+        enPassant = (movedPiece == PAWN) ? (A1 << ((origin + target) >> 1)) & Files[origin] : EMPTY;
+        zKey ^= enPassant ? EnPassantKeys[ffs(enPassant) % SquaresPerRank] : ZKey {0};
+
+        zKey ^= CastlingKeys[castlingRights];
+        castlingRights &= castlingCaptureUpdateFlags(from, to);
+        zKey ^= CastlingKeys[castlingRights];
+    }
+
+    void Position::unmakeMove(Move const move, UndoState const & undoState)
+    {
+        auto const other = static_cast<Color>(sideToMove ^ BLACK);
+        auto const origin = move.origin();
+        auto const target = move.target();
+        auto const movedPiece = move.type() == Move::PROMOTION ? 
+            PAWN : static_cast<Piece>(pieceOn[target] % NumberOfPieceTypes);
+        auto const capturedSquare = move.type() == Move::EN_PASSANT ? 
+            target + ((sideToMove << 1) - 1) * SquaresPerRank : target;
+
+#ifdef COPY_MAKE
+        static_cast<BoardState &>(*this) = undoState.board;
+#else
+        auto const from = A1 << origin;
+        auto const to = A1 << target;
+        auto const placedPiece = static_cast<Piece>(pieceOn[target] % NumberOfPieceTypes);
+
+        togglePieces(sideToMove, placedPiece, to);
+        togglePieces(sideToMove, movedPiece, from);
+
+        if(undoState.captured != KING)
+        {
+            togglePieces(other, undoState.captured, A1 << capturedSquare);
+        }
+
+        zKey = undoState.zKey;
+        enPassant = undoState.enPassant;
+        halfMoves = undoState.halfMoves;
+        castlingRights = undoState.castlingRights;
+#endif
+
+        // the mailbox is reverted incrementally in both modes
+        if(move.type() == Move::CASTLING)
+        {
+            auto const rookOrigin = target > origin ? target + 1 : target - 2;
+            auto const rookTarget = (origin + target) >> 1;
+#ifndef COPY_MAKE
+            togglePieces(sideToMove, ROOK, (A1 << rookOrigin) | (A1 << rookTarget));
+#endif
+            movePiece(rookTarget, rookOrigin);
+        }
+
+        movePiece(target, origin);
+        pieceOn[origin] = sideToMove * NumberOfPieceTypes + movedPiece;
+
+        if(undoState.captured != KING)
+        {
+            putPiece(other, undoState.captured, capturedSquare);
+        }
+    }
+
+    template<SearchType searchType>
     bool Position::evaluateHashMove(int const depth)
     {
         auto entry = transpositionTable.get(zKey);
@@ -995,10 +1734,12 @@ namespace spezi
                 {              
                     // exact score => record score and return immediately  
                     ++exactHashes;
-                    alphaBetaAtDepth[sideToMove][depth] = score;
+                    searchStack[depth].alphaBeta[sideToMove] = score;
                     // important: because of the early exit in evaluate(...), 
-                    // pv table is not updated there for exact hits in the hash table 
-                    storePrincipalVariation(entry, depth);
+                    // pv table is not updated there for exact hits in the hash table,
+                    // the line ends with the hash move (no child has been searched)
+                    principalVariationLength[depth + 1] = 0;
+                    storePrincipalVariation(entry.value<Move, HashEntry::MOVE_MASK>(), depth);
                     return false;
                 }
                 else if(entry.value<HashEntryType, HashEntry::TYPE_MASK>() == CUT_NODE)
@@ -1006,12 +1747,12 @@ namespace spezi
                     ++cutHashes;
                     // cut node, score is a lower/upper bound if white/black to move 
                     // => check if cutoff still stands and return immediately if true
-                    auto const other = sideToMove ^ BLACK;
+                    auto const other = static_cast<Color>(sideToMove ^ BLACK);
                     auto const sign = (other << 1) - 1;     
-                    if(score >= sign * alphaBetaAtDepth[other][depth])
+                    if(score >= sign * searchStack[depth].alphaBeta[other])
                     {
                         ++hashCutoffs;
-                        alphaBetaAtDepth[sideToMove][depth] = alphaBetaAtDepth[other][depth];
+                        searchStack[depth].alphaBeta[sideToMove] = searchStack[depth].alphaBeta[other];
                         return false;
                     }
                 }
@@ -1021,186 +1762,19 @@ namespace spezi
                 }
             }
 
-            auto const movedPiece = entry.value<Piece, HashEntry::MOVED_PIECE_MASK>();
-            auto const capturedPiece = entry.value<Piece, HashEntry::CAPTURED_PIECE_MASK>();
-            auto const promotedPiece = entry.value<Piece, HashEntry::PROMOTED_PIECE_MASK>();
-            auto const origin = entry.value<Square, HashEntry::ORIGIN_SQUARE_MASK>();
-            auto const target = entry.value<Square, HashEntry::TARGET_SQUARE_MASK>();
-            auto const epBefore = entry.value<BitBoard, HashEntry::EN_PASSANT_BEFORE_MASK>();
-            auto const epAfter = entry.value<BitBoard, HashEntry::EN_PASSANT_AFTER_MASK>();
-            auto const castlingBefore = entry.value<unsigned char, HashEntry::CASTLING_BEFORE_MASK>();
-            auto const castlingUpdate = entry.value<unsigned char, HashEntry::CASTLING_UPDATE_MASK>();
-
-            auto const halfMovesAtEntry = halfMoves;
-
-            auto const from = A1 << origin;
-            auto const to = A1 << target;
-
-            zKey ^= PieceKeys[sideToMove][movedPiece][origin];
-            allPieces[sideToMove] ^= from;
-            allPieces[sideToMove] ^= to;
-            individualPieces[movedPiece] ^=from;
-            empty ^= from;
-
-            zKey ^= PieceKeys[sideToMove]
-                [(promotedPiece == KING) * movedPiece + (promotedPiece!=KING) * promotedPiece][target];
-            individualPieces[(promotedPiece == KING) * movedPiece + (promotedPiece!=KING) * promotedPiece] ^= to;
-
-            if(capturedPiece != KING)
-            {
-                halfMoves = 0;
-
-                if(epBefore && target == ffs(epBefore))
-                {
-                    auto const pawn = target + ((sideToMove << 1) - 1) * SquaresPerRank;
-                    zKey ^= PieceKeys[(sideToMove + 1) % 2][capturedPiece][pawn];
-                    allPieces[(sideToMove + 1) % 2] ^= (A1 << pawn); 
-                    individualPieces[capturedPiece] ^= (A1 << pawn);
-                    empty ^= to;
-                    empty ^= (A1 << pawn);
-                }
-                else
-                {
-                    zKey ^= PieceKeys[(sideToMove + 1) % 2][capturedPiece][target];
-                    allPieces[(sideToMove + 1) % 2] ^= to;
-                    individualPieces[capturedPiece] ^= to; 
-                }
-            }
-            else
-            {
-                empty ^= to;
-                halfMoves += movedPiece == PAWN ? -halfMoves : 1; 
-
-                if(movedPiece == KING)
-                {
-                    if(origin == e1)
-                    {
-                        if(target == g1)
-                        {
-                            auto const rookSquares = F1 | H1;
-                            allPieces[WHITE] ^= rookSquares;
-                            individualPieces[ROOK] ^= rookSquares;
-                            empty ^= rookSquares;
-                            zKey ^= PieceKeys[WHITE][ROOK][f1];
-                            zKey ^= PieceKeys[WHITE][ROOK][h1];
-                        }
-                        else if (target == c1)
-                        {
-                            auto const rookSquares = A1 | D1;
-                            allPieces[WHITE] ^= rookSquares;
-                            individualPieces[ROOK] ^= rookSquares;
-                            empty ^= rookSquares;
-                            zKey ^= PieceKeys[WHITE][ROOK][a1];
-                            zKey ^= PieceKeys[WHITE][ROOK][d1];
-                        }
-                    }
-                    else if(origin == e8)
-                    {
-                        if(target == g8)
-                        {
-                            auto const rookSquares = F8 | H8;
-                            allPieces[BLACK] ^= rookSquares;
-                            individualPieces[ROOK] ^= rookSquares;
-                            empty ^= rookSquares;
-                            zKey ^= PieceKeys[BLACK][ROOK][f8];
-                            zKey ^= PieceKeys[BLACK][ROOK][h8];
-                        }
-                        else if(target == c8)
-                        {
-                            auto const rookSquares = A8 | D8;
-                            allPieces[BLACK] ^= rookSquares;
-                            individualPieces[ROOK] ^= rookSquares;
-                            empty ^= rookSquares;
-                            zKey ^= PieceKeys[BLACK][ROOK][A8];
-                            zKey ^= PieceKeys[BLACK][ROOK][D8];
-                        }
-                    }
-                }
-            }
-
-            zKey ^= epBefore ? EnPassantKeys[ffs(epBefore) % SquaresPerRank] : ZKey {0};
-            zKey ^= epAfter ? EnPassantKeys[ffs(epAfter) % SquaresPerRank] : ZKey {0};
-            zKey ^= CastlingKeys[castlingBefore];
-            zKey ^= CastlingKeys[castlingBefore & castlingUpdate];
-
-            castlingRights = castlingBefore & castlingUpdate;
-            enPassant = epAfter;
-
-            evaluate(depth + 1);
-            auto const inWindow = updateWindowOrCutoff(entry.zKey, depth, castlingBefore, epBefore,
-                                origin, target, movedPiece, capturedPiece, promotedPiece, castlingUpdate);
+            auto const move = entry.value<Move, HashEntry::MOVE_MASK>();
 
-            // rollback
-            zKey = entry.zKey;        
-            allPieces[sideToMove] ^= from;
-            allPieces[sideToMove] ^= to;
-            individualPieces[movedPiece] ^=from;
-            empty ^= from;
-
-            individualPieces[(promotedPiece == KING) * movedPiece + (promotedPiece!=KING) * promotedPiece] ^= to;
-
-            if(capturedPiece != KING)
+            // terminal nodes (repetitions, mates, stalemates) are stored without a move
+            if(move.isNull())
             {
-                if(epBefore && target == ffs(epBefore))
-                {
-                    auto const pawn = target + ((sideToMove << 1) - 1) * SquaresPerRank;
-                    allPieces[(sideToMove + 1) % 2] ^= (A1 << pawn); 
-                    individualPieces[capturedPiece] ^= (A1 << pawn);
-                    empty ^= to;
-                    empty ^= (A1 << pawn);
-                }
-                else
-                {
-                    allPieces[(sideToMove + 1) % 2] ^= to;
-                    individualPieces[capturedPiece] ^= to; 
-                }
-            }
-            else
-            {
-                empty ^= to;
-               
-                if(movedPiece == KING)
-                {
-                    if(origin == e1)
-                    {
-                        if(target == g1)
-                        {
-                            auto const rookSquares = F1 | H1;
-                            allPieces[WHITE] ^= rookSquares;
-                            individualPieces[ROOK] ^= rookSquares;
-                            empty ^= rookSquares;
-                        }
-                        else if (target == c1)
-                        {
-                            auto const rookSquares = A1 | D1;
-                            allPieces[WHITE] ^= rookSquares;
-                            individualPieces[ROOK] ^= rookSquares;
-                            empty ^= rookSquares;
-                        }
-                    }
-                    else if(origin == e8)
-                    {
-                        if(target == g8)
-                        {
-                            auto const rookSquares = F8 | H8;
-                            allPieces[BLACK] ^= rookSquares;
-                            individualPieces[ROOK] ^= rookSquares;
-                            empty ^= rookSquares;
-                        }
-                        else if(target == c8)
-                        {
-                            auto const rookSquares = A8 | D8;
-                            allPieces[BLACK] ^= rookSquares;
-                            individualPieces[ROOK] ^= rookSquares;
-                            empty ^= rookSquares;
-                        }
-                    }
-                }
+                return true;
             }
 
-            castlingRights = castlingBefore;
-            enPassant = epBefore;
-            halfMoves = halfMovesAtEntry;
+            auto & undoState = undoStateAtDepth[depth];
+            makeMove(move, undoState);
+            evaluate<searchType>(depth + 1);
+            auto const inWindow = updateWindowOrCutoff(entry.zKey, depth, move);
+            unmakeMove(move, undoState);
 
             return inWindow;
         }
@@ -1209,9 +1783,6 @@ namespace spezi
 
     bool Position::evaluateNullMove(int const depth)
     {
-#ifdef PERFT
-        return true;
-#endif
         auto constexpr R = 3;   // standard depth decrease R = 3 for null move heuristic
         
         if(nullMoveDepth == maxConsecutiveNullMoves)
@@ -1219,9 +1790,15 @@ namespace spezi
             return true;
         }            
 
-        auto const other = sideToMove ^ BLACK;
+        // passing is not a legal move in check
+        if(searchStack[depth].checkers)
+        {
+            return true;
+        }
+
+        auto const other = static_cast<Color>(sideToMove ^ BLACK);
         auto const sign = (other << 1) - 1;     
-        auto const beta = absAdd(alphaBetaAtDepth[other][depth - nullMoveDepth * R], (nullMoveDepth + 1) * R);
+        auto const beta = absAdd(searchStack[depth - nullMoveDepth * R].alphaBeta[other], (nullMoveDepth + 1) * R);
 
         // - call evaluation with depth + 3 (instead of + 1)  
         // - with null window, we are only interested in beta cutoffs, not in alpha increases
@@ -1231,531 +1808,490 @@ namespace spezi
         auto const betaDec = absDec(beta);
         auto const alphaDec = betaDec - sign;   
 
-        alphaBetaAtDepth[sideToMove][depth + R - 1] = alphaDec;
-        alphaBetaAtDepth[other][depth + R - 1] = betaDec;
+        searchStack[depth + R - 1].alphaBeta[sideToMove] = alphaDec;
+        searchStack[depth + R - 1].alphaBeta[other] = betaDec;
 
         auto const enPassantAtEntry = enPassant;
         enPassant = EMPTY;
         zKey ^= enPassantAtEntry ? EnPassantKeys[ffs(enPassantAtEntry) % SquaresPerRank] : ZKey {0};
         ++nullMoveDepth;
         ++nullMovesOnBranch;
-        evaluate(depth + R);
+        evaluate<MAIN_SEARCH>(depth + R);
         --nullMovesOnBranch;
         --nullMoveDepth;
         zKey ^= enPassantAtEntry ? EnPassantKeys[ffs(enPassantAtEntry) % SquaresPerRank] : ZKey {0};
         enPassant = enPassantAtEntry;
 
-        auto const score = alphaBetaAtDepth[other][depth + R];
+        auto const score = searchStack[depth + R].alphaBeta[other];
         if(sign * score >= sign * beta)
         {
             ++nullMoveCutoffs;
-            alphaBetaAtDepth[sideToMove][depth] = absAdd(beta, -R);
+            searchStack[depth].alphaBeta[sideToMove] = absAdd(beta, -R);
             return false;
         }
 
         return true;
     }
 
+    template<SearchType searchType>
     bool Position::evaluateCaptures(int const depth)
     {
-        auto const other = sideToMove ^ BLACK;
-        auto const promotionRank = (sideToMove == WHITE ? RANKS[SquaresPerFile-2] : RANKS[1]);
+        return sideToMove == WHITE ? evaluateCaptures<searchType, WHITE>(depth) : evaluateCaptures<searchType, BLACK>(depth);
+    }
 
-        auto const castlingRightsAtEntry = castlingRights;
+    template<SearchType searchType, Color color>
+    bool Position::evaluateCaptures(int const depth)
+    {
+        auto constexpr other = static_cast<Color>(color ^ BLACK);
         auto const zKeyAtEntry = zKey;
-        zKey ^= enPassant ? EnPassantKeys[ffs(enPassant) % SquaresPerRank] : ZKey {0};
-        auto const enPassantAtEntry = enPassant;
-        enPassant = EMPTY;
-        auto const halfMovesAtEntry = halfMoves;
-        halfMoves = 0;
+        auto & undoState = undoStateAtDepth[depth];
 
         bool inWindow = true;
 
+        // only look for attackers of pieces that are attacked at all
+        auto const attacked = attackedBy(attackMapsAtDepth[depth], color);
+        auto const king = ffs(piecesOf(color, KING));
+        auto const & legality = pinsAndEvasions(depth);
+
+        // targets of all pawn captures, shifted back to their origins per target below
+        auto constexpr westOffset = WestCaptureOffset[color];
+        auto constexpr eastOffset = EastCaptureOffset[color];
+        auto const pawns = piecesOf(color, PAWN);
+        auto const westCaptures = shiftBy(pawns & ~FILES[0], westOffset);
+        auto const eastCaptures = shiftBy(pawns & ~FILES[SquaresPerRank - 1], eastOffset);
+
         // MVV-LVA: queens first
         for(auto attackedPiece = static_cast<int>(QUEEN); 
             (attackedPiece >= static_cast<int>(PAWN)) && inWindow;
             --attackedPiece)
         {
-            auto targets = allPieces[other] & individualPieces[attackedPiece];
+            auto targets = piecesOf(other, attackedPiece) & attacked;
             while(targets && inWindow)
             {
                 auto const target = ffs(targets);
 
                 auto const diagonalAttacks = 
-                    Diagonals[target] & allPieces[sideToMove] & (individualPieces[BISHOP] | individualPieces[QUEEN]) ?
-                    DiagonalAttacks[target][pext(~empty, DiagonalMasks[target])] : EMPTY;
+                    Diagonals[target] & piecesOf(color) & diagonalSliders() ?
+                    bishopAttacks(target, ~emptySquares()) : EMPTY;
                 
-                auto const rankAttacks = 
-                    Ranks[target] & allPieces[sideToMove] & (individualPieces[ROOK] | individualPieces[QUEEN]) ?
-                RankAttacks[target][pext(~empty, RankMasks[target])] : EMPTY;
-
-                auto const fileAttacks = 
-                    Files[target] & allPieces[sideToMove] & (individualPieces[ROOK] | individualPieces[QUEEN]) ?
-                    FileAttacks[target][pext(~empty, FileMasks[target])] : EMPTY;
+                auto const orthogonalAttacks = 
+                    (Ranks[target] | Files[target]) & piecesOf(color) & orthogonalSliders() ?
+                    rookAttacks(target, ~emptySquares()) : EMPTY;
 
                 auto const to = A1 << target;
-                allPieces[sideToMove] ^= to;
-                allPieces[other] ^= to;
-                individualPieces[attackedPiece] ^= to;
-		        zKey ^= PieceKeys[other][attackedPiece][target];
-		
-                // generate attackers by finding reverse color attacks from target square
-                BitBoard attackers[NumberOfPieceTypes];
-                attackers[PAWN] = PawnAttacks[other][target] & allPieces[sideToMove] & individualPieces[PAWN];
-                attackers[KNIGHT] = KnightAttacks[target] & allPieces[sideToMove] & individualPieces[KNIGHT]; 
-                attackers[BISHOP] = diagonalAttacks & allPieces[sideToMove] & individualPieces[BISHOP];
-                attackers[ROOK] = (rankAttacks | fileAttacks) & allPieces[sideToMove] & individualPieces[ROOK];
-                attackers[QUEEN] = (diagonalAttacks | rankAttacks | fileAttacks) & allPieces[sideToMove] & individualPieces[QUEEN];
-                attackers[KING] = KingAttacks[target] & allPieces[sideToMove] & individualPieces[KING];
-
-                // MVV-LVA: pawns first
-                for(auto attackingPiece = static_cast<int>(PAWN); 
-                    (attackingPiece != NumberOfPieceTypes) && inWindow;
-                    ++attackingPiece)
-                {
-                    individualPieces[attackingPiece] ^= to;
-                    zKey ^= PieceKeys[sideToMove][attackingPiece][target];
 
-                    while(attackers[attackingPiece] && inWindow)
-                    {
-                        auto const attacker = ffs(attackers[attackingPiece]);
-                        auto const from = A1 << attacker;
-                        
-                        allPieces[sideToMove] ^= from;
-                        individualPieces[attackingPiece] ^= from;
-                        empty ^= from;           
-                        zKey ^= PieceKeys[sideToMove][attackingPiece][attacker];
-                        zKey ^= CastlingKeys[castlingRights];     
-                        auto const castlingUpdate = castlingCaptureUpdateFlags(from, to);         
-                        castlingRights &= castlingUpdate;
-                        zKey ^= CastlingKeys[castlingRights];             
-
-                        if(attackingPiece == PAWN && from & promotionRank)
-                        {
-                            individualPieces[attackingPiece] ^= to;
-                            zKey ^= PieceKeys[sideToMove][attackingPiece][target];
-                            for(int promotedPiece = static_cast<int>(QUEEN); 
-                                promotedPiece != static_cast<int>(PAWN);
-                                --promotedPiece)
-                            {
-                                individualPieces[promotedPiece] ^= to;
-                                zKey ^= PieceKeys[sideToMove][promotedPiece][target];
-                                evaluate(depth + 1);
-                                inWindow = updateWindowOrCutoff(
-                                    zKeyAtEntry, depth, castlingRightsAtEntry, enPassantAtEntry,
-                                    attacker, target, static_cast<Piece>(attackingPiece),
-                                    static_cast<Piece>(attackedPiece), 
-                                    static_cast<Piece>(promotedPiece), castlingUpdate);
-                                --halfMoves;                            
-                                individualPieces[promotedPiece] ^= to;
-                                zKey ^= PieceKeys[sideToMove][promotedPiece][target];
-                            }            
-                            individualPieces[attackingPiece] ^= to;
-                            zKey ^= PieceKeys[sideToMove][attackingPiece][target];
-                        }
-                        else
-                        { 
-                            evaluate(depth + 1);
-                            inWindow = updateWindowOrCutoff(
-                                    zKeyAtEntry, depth, castlingRightsAtEntry, enPassantAtEntry,
-                                    attacker, target, static_cast<Piece>(attackingPiece),
-                                    static_cast<Piece>(attackedPiece));
-                        }
-
-                        allPieces[sideToMove] ^= from;
-                        individualPieces[attackingPiece] ^= from;
-                        empty ^= from;
-                        zKey ^= PieceKeys[sideToMove][attackingPiece][attacker];
-                        zKey ^= CastlingKeys[castlingRights];             
-                        castlingRights = castlingRightsAtEntry;
-                        zKey ^= CastlingKeys[castlingRights];             
+                // all pieces but the king have to resolve checks and stay on their pin lines,
+                // king captures are verified after the move (the king must not shield the target)
+                auto const movable = (to & legality.evasions) ? ~legality.pinned | Line[king][target] : EMPTY;
 
-                        attackers[attackingPiece] &= attackers[attackingPiece] - 1;
-                    }
-
-                    individualPieces[attackingPiece] ^= to;
-                    zKey ^= PieceKeys[sideToMove][attackingPiece][target];
-                }
-
-                allPieces[sideToMove] ^= to;
-                allPieces[other] ^= to;
-                individualPieces[attackedPiece] ^= to;
-		        zKey ^= PieceKeys[other][attackedPiece][target];
+                // generate attackers by finding reverse color attacks from target square, 
+                // MVV-LVA: pawns first
+                inWindow = evaluateCapturesBy<searchType, color, PAWN>(depth, zKeyAtEntry, target,
+                        (shiftBy(westCaptures & to, -westOffset) | shiftBy(eastCaptures & to, -eastOffset)) & movable)
+                    && evaluateCapturesBy<searchType, color, KNIGHT>(depth, zKeyAtEntry, target, 
+                        KnightAttacks[target] & piecesOf(color, KNIGHT) & movable)
+                    && evaluateCapturesBy<searchType, color, BISHOP>(depth, zKeyAtEntry, target, 
+                        diagonalAttacks & piecesOf(color, BISHOP) & movable)
+                    && evaluateCapturesBy<searchType, color, ROOK>(depth, zKeyAtEntry, target, 
+                        orthogonalAttacks & piecesOf(color, ROOK) & movable)
+                    && evaluateCapturesBy<searchType, color, QUEEN>(depth, zKeyAtEntry, target, 
+                        (diagonalAttacks | orthogonalAttacks) & piecesOf(color, QUEEN) & movable)
+                    && evaluateCapturesBy<searchType, color, KING>(depth, zKeyAtEntry, target, 
+                        KingAttacks[target] & piecesOf(color, KING));
 				
                 targets &= targets - 1;
             }
         }
 
-        if(enPassantAtEntry && inWindow)
+        if(enPassant && inWindow)
         {
-            auto const target = ffs(enPassantAtEntry);
-            auto const pawn = A1 << (target + (SquaresPerRank * ((sideToMove << 1) - 1)));
-            auto attackers = PawnAttacks[other][target] & allPieces[sideToMove] & individualPieces[PAWN];
-            individualPieces[PAWN] ^= enPassantAtEntry;
-            individualPieces[PAWN] ^= pawn;
-            allPieces[sideToMove] ^= enPassantAtEntry;
-            allPieces[other] ^= pawn;
-            empty ^= (enPassantAtEntry ^ pawn);
-	        zKey ^= PieceKeys[other][PAWN][ffs(pawn)];
-	        zKey ^= PieceKeys[sideToMove][PAWN][target];
+            auto const target = ffs(enPassant);
+            auto attackers = shiftBy(westCaptures & enPassant, -westOffset) | shiftBy(eastCaptures & enPassant, -eastOffset);
 	        while(attackers && inWindow)
             {
-                auto const attacker = ffs(attackers);
-                auto const from = A1 << attacker;
-                allPieces[sideToMove] ^= from;
-                individualPieces[PAWN] ^= from;
-                empty ^= from;
-		        zKey ^= PieceKeys[sideToMove][PAWN][attacker];
-                evaluate(depth + 1);
-                inWindow = updateWindowOrCutoff(
-                    zKeyAtEntry, depth, castlingRightsAtEntry, enPassantAtEntry,
-                    attacker, target, PAWN, PAWN);
-                allPieces[sideToMove] ^= from;
-                individualPieces[PAWN] ^= from;
-                empty ^= from;
-		        zKey ^= PieceKeys[sideToMove][PAWN][attacker];
+                auto const move = Move(ffs(attackers), target, Move::EN_PASSANT);
+                makeMove(move, undoState);
+                // en passant removes two pieces from the king's lines => verify after the move
+                if(!isAttacked(other, king))
+                {
+                    evaluate<searchType>(depth + 1);
+                    inWindow = updateWindowOrCutoff<searchType, color>(zKeyAtEntry, depth, move);
+                }
+                unmakeMove(move, undoState);
 				
                 attackers &= attackers - 1;
             }
-            individualPieces[PAWN] ^= enPassantAtEntry;
-            individualPieces[PAWN] ^= pawn;
-            allPieces[sideToMove] ^= enPassantAtEntry;
-            allPieces[other] ^= pawn;
-            empty ^= (enPassantAtEntry ^ pawn);
-	        zKey ^= PieceKeys[other][PAWN][ffs(pawn)];
-	        zKey ^= PieceKeys[sideToMove][PAWN][target];	    
         }
 
-        enPassant = enPassantAtEntry;
-        zKey ^= enPassant ? EnPassantKeys[ffs(enPassant) % SquaresPerRank] : ZKey {0};
-        halfMoves = halfMovesAtEntry;
-
         return inWindow;
     }
 
-    bool Position::evaluateNonCaptures(int const depth)
+    template<SearchType searchType, Color color, Piece piece>
+    bool Position::evaluateCapturesBy(int const depth, ZKey const zKeyAtEntry, Square const target, BitBoard attackers)
     {
-        auto const promotionRank = ((sideToMove == WHITE) ? RANKS[SquaresPerFile-2] : RANKS[1]);
-      
-        auto const castlingRightsAtEntry = castlingRights;
-        unsigned char castlingUpdate = 0xF;
-        auto const zKeyAtEntry = zKey;
-        zKey ^= enPassant ? EnPassantKeys[ffs(enPassant) % SquaresPerRank] : ZKey{0};
-        auto const enPassantAtEntry = enPassant;
-        enPassant = EMPTY;
-        auto const halfMovesAtEntry = halfMoves;
-        ++halfMoves;
+        auto constexpr other = static_cast<Color>(color ^ BLACK);
+        auto constexpr promotionRank = RANKS[color == WHITE ? SquaresPerFile - 2 : 1];
+        auto & undoState = undoStateAtDepth[depth];
 
         bool inWindow = true;
 
-        for(auto movingPiece = static_cast<int>(PAWN);
-            (movingPiece != NumberOfPieceTypes) && inWindow;
-            ++movingPiece)
-        {   
-            auto movers = allPieces[sideToMove] & individualPieces[movingPiece];
-            
-            while(movers && inWindow)
-            {
-                auto const mover = ffs(movers);
-                auto const from = A1 << mover;
-                allPieces[sideToMove] ^= from;
-                individualPieces[movingPiece] ^= from;
-                empty ^= from;
-                zKey ^= PieceKeys[sideToMove][movingPiece][mover];
-                if(movingPiece == KING || movingPiece == ROOK)
+        while(attackers && inWindow)
+        {
+            auto const attacker = ffs(attackers);
+
+            if(piece == PAWN && (A1 << attacker) & promotionRank)
+            {
+                for(int promotedPiece = static_cast<int>(QUEEN); 
+                    (promotedPiece != static_cast<int>(PAWN)) && inWindow;
+                    --promotedPiece)
                 {
-                    zKey ^= CastlingKeys[castlingRights];  
-                    castlingUpdate = castlingCaptureUpdateFlags(from, from);
-                    castlingRights &= castlingUpdate;
-                    zKey ^= CastlingKeys[castlingRights];
+                    auto const move = Move(attacker, target, Move::PROMOTION, static_cast<Piece>(promotedPiece));
+                    makeMove(move, undoState);
+                    evaluate<searchType>(depth + 1);
+                    inWindow = updateWindowOrCutoff<searchType, color>(zKeyAtEntry, depth, move);
+                    unmakeMove(move, undoState);
+                }
+            }
+            else
+            {
+                auto const move = Move(attacker, target);
+                makeMove(move, undoState);
+                if(piece != KING || !isAttacked(other, target))
+                { 
+                    evaluate<searchType>(depth + 1);
+                    inWindow = updateWindowOrCutoff<searchType, color>(zKeyAtEntry, depth, move);
                 }
+                unmakeMove(move, undoState);
+            }
 
-                auto targets = generateNonCaptureSquares(static_cast<Piece>(movingPiece), mover);
+            attackers &= attackers - 1;
+        }
 
-                while(targets && inWindow)
-                {
-                    auto const target = ffs(targets);
-                    auto const to = A1 << target;
+        return inWindow;
+    }
 
-                    allPieces[sideToMove] ^= to;    
-                    empty ^= to;    
+    template<SearchType searchType>
+    bool Position::evaluateNonCaptures(int const depth)
+    {
+        return sideToMove == WHITE ? evaluateNonCaptures<searchType, WHITE>(depth) : evaluateNonCaptures<searchType, BLACK>(depth);
+    }
 
-                    if(movingPiece == PAWN)
-                    {
-                        halfMoves = 0;
+    template<SearchType searchType, Color color>
+    bool Position::evaluateNonCaptures(int const depth)
+    {
+        auto constexpr other = static_cast<Color>(color ^ BLACK); 
+        auto const king = ffs(piecesOf(color, KING));
+        auto const & legality = pinsAndEvasions(depth);
+        auto const zKeyAtEntry = zKey;
+        auto & undoState = undoStateAtDepth[depth];
 
-                        if(from & promotionRank)
-                        {
-                            for(int promotedPiece = static_cast<int>(QUEEN); 
-                                promotedPiece != static_cast<int>(PAWN);
-                                --promotedPiece)
-                            {
-                                individualPieces[promotedPiece] ^= to;
-                                zKey ^= PieceKeys[sideToMove][promotedPiece][target];
-                                evaluate(depth + 1);
-                                inWindow = updateWindowOrCutoff(
-                                    zKeyAtEntry, depth, castlingRightsAtEntry, enPassantAtEntry,
-                                    mover, target, static_cast<Piece>(movingPiece),
-                                    KING, static_cast<Piece>(promotedPiece));
-                                individualPieces[promotedPiece] ^= to;
-                                zKey ^= PieceKeys[sideToMove][promotedPiece][target];
-                            }
-                        }
-                        else
-                        {
-                            individualPieces[PAWN] ^= to;
-                            zKey ^= PieceKeys[sideToMove][PAWN][target];
-                            enPassant = (A1 << ((ffs(from) + ffs(to)) >> 1)) & Files[mover];
-                            zKey ^= enPassant ? EnPassantKeys[ffs(enPassant) % SquaresPerRank] : ZKey {0};
-                            evaluate(depth + 1);
-                            inWindow = updateWindowOrCutoff(
-                                    zKeyAtEntry, depth, castlingRightsAtEntry, enPassantAtEntry,
-                                    mover, target, static_cast<Piece>(movingPiece));
-                            individualPieces[PAWN] ^= to;
-                            zKey ^= PieceKeys[sideToMove][PAWN][target];
-                            zKey ^= enPassant ? EnPassantKeys[ffs(enPassant) % SquaresPerRank] : ZKey {0};
-                            enPassant = EMPTY;
-                        }
+        bool inWindow = true;
 
-                        halfMoves = halfMovesAtEntry + 1;
-                    }                     
-                    else 
-                    {    
-                        individualPieces[movingPiece] ^= to;
-                        zKey ^= PieceKeys[sideToMove][movingPiece][target];
-                        evaluate(depth + 1);
-                        inWindow = updateWindowOrCutoff(
-                                    zKeyAtEntry, depth, castlingRightsAtEntry, enPassantAtEntry,
-                                    mover, target, static_cast<Piece>(movingPiece), KING, KING, castlingUpdate);
-                        individualPieces[movingPiece] ^= to;
-                        zKey ^= PieceKeys[sideToMove][movingPiece][target];
-                    }
-                    
-                    allPieces[sideToMove] ^= to;
-                    empty ^= to;
+        // pawn pushes set-wise: pinned pawns can only push along the king's file
+        auto constexpr offset = PawnPushOffset[color];
+        auto constexpr lastRank = RANKS[color == WHITE ? SquaresPerFile - 1 : 0];
+        auto constexpr doublePushRank = RANKS[color == WHITE ? 2 : SquaresPerFile - 3];
+        auto const pawns = piecesOf(color, PAWN) & (~legality.pinned | Files[king]);
+        auto const singlePushes = shiftBy(pawns, offset) & emptySquares();
+        auto const doublePushes = shiftBy(singlePushes & doublePushRank, offset) & emptySquares() & legality.evasions;
 
-                    targets &= targets - 1;            
-                }
-            
-                allPieces[sideToMove] ^= from;
-                individualPieces[movingPiece] ^= from;
-                empty ^= from;
-                zKey ^= PieceKeys[sideToMove][movingPiece][mover];
-                if(movingPiece == KING || movingPiece == ROOK)
-                {
-                    zKey ^= CastlingKeys[castlingRights];  
-                    castlingRights = castlingRightsAtEntry;
-                    zKey ^= CastlingKeys[castlingRights];
-                    castlingUpdate = 0xF;
-                }
-                
-                movers &= movers - 1;
+        for(auto targets = singlePushes & legality.evasions & lastRank; targets && inWindow; targets &= targets - 1)
+        {
+            auto const target = ffs(targets);
+            for(int promotedPiece = static_cast<int>(QUEEN); 
+                (promotedPiece != static_cast<int>(PAWN)) && inWindow;
+                --promotedPiece)
+            {
+                auto const move = Move(target - offset, target, Move::PROMOTION, static_cast<Piece>(promotedPiece));
+                makeMove(move, undoState);
+                evaluate<searchType>(depth + 1);
+                inWindow = updateWindowOrCutoff<searchType, color>(zKeyAtEntry, depth, move);
+                unmakeMove(move, undoState);
             }
         }
 
-        auto const shift = sideToMove * 56;
-        auto const other = static_cast<Color>(sideToMove ^ BLACK); 
+        for(auto targets = singlePushes & legality.evasions & ~lastRank; targets && inWindow; targets &= targets - 1)
+        {
+            auto const target = ffs(targets);
+            auto const move = Move(target - offset, target);
+            makeMove(move, undoState);
+            evaluate<searchType>(depth + 1);
+            inWindow = updateWindowOrCutoff<searchType, color>(zKeyAtEntry, depth, move);
+            unmakeMove(move, undoState);
+        }
+
+        for(auto targets = doublePushes; targets && inWindow; targets &= targets - 1)
+        {
+            auto const target = ffs(targets);
+            auto const move = Move(target - 2 * offset, target);
+            makeMove(move, undoState);
+            evaluate<searchType>(depth + 1);
+            inWindow = updateWindowOrCutoff<searchType, color>(zKeyAtEntry, depth, move);
+            unmakeMove(move, undoState);
+        }
+
+        inWindow = inWindow
+            && evaluateNonCapturesBy<searchType, color, KNIGHT>(depth, zKeyAtEntry)
+            && evaluateNonCapturesBy<searchType, color, BISHOP>(depth, zKeyAtEntry)
+            && evaluateNonCapturesBy<searchType, color, ROOK>(depth, zKeyAtEntry)
+            && evaluateNonCapturesBy<searchType, color, QUEEN>(depth, zKeyAtEntry)
+            && evaluateNonCapturesBy<searchType, color, KING>(depth, zKeyAtEntry);
+
+        auto constexpr shift = color * 56;
 
         if(inWindow
-            && (castlingRights & (1 << (sideToMove << 1)))
-            && (((empty >> shift) & (F1|G1)) == (F1|G1))
-            && !isAttacked(other, ffs(F1 << shift))
-            && !isAttacked(other, ffs(E1 << shift)))
-        {
-            auto const affectedKingSquares = (E1 | G1) << shift;
-            auto const affectedRookSquares = (H1 | F1) << shift;
-            auto const affectedSquares = affectedKingSquares | affectedRookSquares;
-            allPieces[sideToMove] ^= affectedSquares;
-            empty ^= affectedSquares;
-            individualPieces[KING] ^= affectedKingSquares;
-            individualPieces[ROOK] ^= affectedRookSquares;
-            zKey ^= PieceKeys[sideToMove][KING][e1 + shift];
-            zKey ^= PieceKeys[sideToMove][KING][g1 + shift];
-            zKey ^= PieceKeys[sideToMove][ROOK][h1 + shift];
-            zKey ^= PieceKeys[sideToMove][ROOK][f1 + shift];
-            zKey ^= CastlingKeys[castlingRights];
-            castlingRights &= ~(3 << (sideToMove << 1));
-            zKey ^= CastlingKeys[castlingRights];
-            evaluate(depth + 1);
-            inWindow = updateWindowOrCutoff(
-                        zKeyAtEntry, depth, castlingRightsAtEntry, enPassantAtEntry,
-                        e1 + shift, g1 + shift, KING, KING, KING, 0xC);
-            allPieces[sideToMove] ^= affectedSquares;
-            empty ^= affectedSquares;
-            individualPieces[KING] ^= affectedKingSquares;
-            individualPieces[ROOK] ^= affectedRookSquares;
-            zKey ^= PieceKeys[sideToMove][KING][e1 + shift];
-            zKey ^= PieceKeys[sideToMove][KING][g1 + shift];
-            zKey ^= PieceKeys[sideToMove][ROOK][h1 + shift];
-            zKey ^= PieceKeys[sideToMove][ROOK][f1 + shift];
-            zKey ^= CastlingKeys[castlingRights];
-            castlingRights = castlingRightsAtEntry;
-            zKey ^= CastlingKeys[castlingRights];
+            && (castlingRights & (1 << (color << 1)))
+            && (((emptySquares() >> shift) & (F1|G1)) == (F1|G1))
+            && !(attackedBy(attackMapsAtDepth[depth], other) & ((E1 | F1 | G1) << shift)))
+        {
+            auto const move = Move(e1 + shift, g1 + shift, Move::CASTLING);
+            makeMove(move, undoState);
+            evaluate<searchType>(depth + 1);
+            inWindow = updateWindowOrCutoff<searchType, color>(zKeyAtEntry, depth, move);
+            unmakeMove(move, undoState);
         }
         if(inWindow &&
-            (castlingRights & (2 << (sideToMove << 1)))
-            && (((empty >> shift) & (B1|C1|D1)) == (B1|C1|D1))
-            && !isAttacked(other, ffs(D1 << shift))
-            && !isAttacked(other, ffs(E1 << shift)))
-        {
-            auto const affectedKingSquares = (E1 | C1) << shift;
-            auto const affectedRookSquares = (A1 | D1) << shift;
-            auto const affectedSquares = affectedKingSquares | affectedRookSquares;
-            allPieces[sideToMove] ^= affectedSquares;
-            empty ^= affectedSquares;
-            individualPieces[KING] ^= affectedKingSquares;
-            individualPieces[ROOK] ^= affectedRookSquares;
-            zKey ^= PieceKeys[sideToMove][KING][e1 + shift];
-            zKey ^= PieceKeys[sideToMove][KING][c1 + shift];
-            zKey ^= PieceKeys[sideToMove][ROOK][a1 + shift];
-            zKey ^= PieceKeys[sideToMove][ROOK][d1 + shift];
-            zKey ^= CastlingKeys[castlingRights];
-            castlingRights &= ~(3 << (sideToMove << 1));
-            zKey ^= CastlingKeys[castlingRights];
-            evaluate(depth + 1);
-            inWindow = updateWindowOrCutoff(
-                        zKeyAtEntry, depth, castlingRightsAtEntry, enPassantAtEntry,
-                        e1 + shift, c1 + shift, KING, KING, KING, 0x3);
-            allPieces[sideToMove] ^= affectedSquares;
-            empty ^= affectedSquares;
-            individualPieces[KING] ^= affectedKingSquares;
-            individualPieces[ROOK] ^= affectedRookSquares;
-            zKey ^= PieceKeys[sideToMove][KING][e1 + shift];
-            zKey ^= PieceKeys[sideToMove][KING][c1 + shift];
-            zKey ^= PieceKeys[sideToMove][ROOK][a1 + shift];
-            zKey ^= PieceKeys[sideToMove][ROOK][d1 + shift];
-            zKey ^= CastlingKeys[castlingRights];
-            castlingRights = castlingRightsAtEntry;
-            zKey ^= CastlingKeys[castlingRights];
+            (castlingRights & (2 << (color << 1)))
+            && (((emptySquares() >> shift) & (B1|C1|D1)) == (B1|C1|D1))
+            && !(attackedBy(attackMapsAtDepth[depth], other) & ((C1 | D1 | E1) << shift)))
+        {
+            auto const move = Move(e1 + shift, c1 + shift, Move::CASTLING);
+            makeMove(move, undoState);
+            evaluate<searchType>(depth + 1);
+            inWindow = updateWindowOrCutoff<searchType, color>(zKeyAtEntry, depth, move);
+            unmakeMove(move, undoState);
         }
 
-        enPassant = enPassantAtEntry;
-        zKey ^= enPassant ? EnPassantKeys[ffs(enPassant) % SquaresPerRank]: ZKey{0};
-        halfMoves = halfMovesAtEntry;
+        return inWindow;
+    }
+
+    template<SearchType searchType, Color color, Piece piece>
+    bool Position::evaluateNonCapturesBy(int const depth, ZKey const zKeyAtEntry)
+    {
+        auto constexpr other = static_cast<Color>(color ^ BLACK); 
+        auto const king = ffs(piecesOf(color, KING));
+        auto const & legality = pinsAndEvasions(depth);
+        auto & undoState = undoStateAtDepth[depth];
+
+        bool inWindow = true;
+
+        auto movers = piecesOf(color, piece);
+        while(movers && inWindow)
+        {
+            auto const mover = ffs(movers);
+
+            auto targets = generateNonCaptureSquares<piece>(mover);
+            if constexpr(piece != KING)
+            {
+                targets &= legality.evasions & ((A1 << mover) & legality.pinned ? Line[king][mover] : ~EMPTY);
+            }
+
+            while(targets && inWindow)
+            {
+                auto const target = ffs(targets);
+                auto const move = Move(mover, target);
+                makeMove(move, undoState);
+                if(piece != KING || !isAttacked(other, target))
+                {
+                    evaluate<searchType>(depth + 1);
+                    inWindow = updateWindowOrCutoff<searchType, color>(zKeyAtEntry, depth, move);
+                }
+                unmakeMove(move, undoState);
+
+                targets &= targets - 1;            
+            }
+            
+            movers &= movers - 1;
+        }
 
         return inWindow;
     }
 
-    bool Position::updateWindowOrCutoff(
-        ZKey originalZKey,
-        int depth,
-        unsigned char originalCastling,
-        BitBoard originalEnPassant,
-        Square origin, 
-        Square target,
-        Piece moved,
-        Piece captured,
-        Piece promoted,            
-        unsigned char castlingUpdate)
+    bool Position::updateWindowOrCutoff(ZKey const originalZKey, int const depth, Move const move)
     {
-#ifdef PERFT
-        return true;
-#endif 
-        auto const other = sideToMove ^ BLACK;
-        auto const score = absDec(alphaBetaAtDepth[other][depth + 1]);
-        auto const sign = (other << 1) - 1;
+        return sideToMove == WHITE ? updateWindowOrCutoff<MAIN_SEARCH, WHITE>(originalZKey, depth, move) 
+            : updateWindowOrCutoff<MAIN_SEARCH, BLACK>(originalZKey, depth, move);
+    }
+
+    template<SearchType searchType, Color color>
+    bool Position::updateWindowOrCutoff(ZKey const originalZKey, int const depth, Move const move)
+    {
+        if constexpr(searchType == PERFT_SEARCH)
+        {
+            if(depth == 0 && perftShortcuts)
+            {
+                auto numberOfNodes = searchStack[maxDepth].numberOfNodes;
+                for(auto const & rootMove : perftRootMoves)
+                {
+                    numberOfNodes -= rootMove.second;
+                }
+                perftRootMoves.emplace_back(move, numberOfNodes);
+            }
+            return true;
+        }
  
-        if(sign * score >= sign * alphaBetaAtDepth[other][depth])   
+        auto constexpr other = static_cast<Color>(color ^ BLACK);
+        auto constexpr sign = (other << 1) - 1;
+        auto const score = absDec(searchStack[depth + 1].alphaBeta[other]);
+ 
+        if(sign * score >= sign * searchStack[depth].alphaBeta[other])   
         {
             // cutoff
-            alphaBetaAtDepth[sideToMove][depth] = alphaBetaAtDepth[other][depth];
+            searchStack[depth].alphaBeta[color] = searchStack[depth].alphaBeta[other];
 
             //if(depth<maxDepth)
             //{
-                hashEntryAtDepth[depth] = HashEntry(CUT_NODE, originalZKey, maxDepth - depth, 
-                    score, originalCastling, originalEnPassant, origin, target, 
-                    moved, captured, promoted, castlingUpdate);
+                searchStack[depth].hashEntry = HashEntry(CUT_NODE, originalZKey, maxDepth - depth, score, move);
             //}
             ++betaCutoffs;
 
             return false;
         }
 
-        if(sign * score > sign * alphaBetaAtDepth[sideToMove][depth])
+        if(sign * score > sign * searchStack[depth].alphaBeta[color])
         {
             if(depth == 0)
             {
-                hashEntryAtDepth[depth] = {};
+                searchStack[depth].hashEntry = {};
             }
 
             // raise alpha / lower beta
-            alphaBetaAtDepth[sideToMove][depth] = score;
+            searchStack[depth].alphaBeta[color] = score;
 
             ++alphaRaises;
 
+            // lines below null moves never make it to the root
+            if(!nullMovesOnBranch)
+            {
+                storePrincipalVariation(move, depth);
+            }
+
 //            if(depth < maxDepth)
 //            {
-                hashEntryAtDepth[depth] = HashEntry(PV_NODE, originalZKey, maxDepth - depth, 
-                    score, originalCastling, originalEnPassant, origin, target, 
-                    moved, captured, promoted, castlingUpdate);
+                searchStack[depth].hashEntry = HashEntry(PV_NODE, originalZKey, maxDepth - depth, score, move);
 //            }
         }
         return true;
     }
     
-    BitBoard Position::generateNonCaptureSquares(Piece const piece, Square const origin) const
+    template<Piece piece>
+    BitBoard Position::generateNonCaptureSquares(Square const origin) const
+    {
+        static_assert(piece != PAWN, "pawn pushes are generated set-wise");
+        return detail::reachable<piece>(origin, ~emptySquares()) & emptySquares();
+    }
+
+    template<Color color>
+    int Position::countLegalMoves(int const depth)
     {
-        switch(piece)
+        auto constexpr other = static_cast<Color>(color ^ BLACK);
+        auto const king = ffs(piecesOf(color, KING));
+        auto const & legality = pinsAndEvasions(depth);
+        auto const occupied = ~emptySquares();
+        auto const notOwn = ~piecesOf(color);
+        auto const enemies = piecesOf(other);
+
+        // pawns set-wise, promotions count four times, pinned pawns capture along their pin line only
+        auto constexpr offset = PawnPushOffset[color];
+        auto constexpr westOffset = WestCaptureOffset[color];
+        auto constexpr eastOffset = EastCaptureOffset[color];
+        auto constexpr lastRank = RANKS[color == WHITE ? SquaresPerFile - 1 : 0];
+        auto constexpr doublePushRank = RANKS[color == WHITE ? 2 : SquaresPerFile - 3];
+        auto const pawnMoves = [lastRank](BitBoard const targets)
+        {
+            return popcount(targets & ~lastRank) + 4 * popcount(targets & lastRank);
+        };
+
+        auto const pawns = piecesOf(color, PAWN);
+        auto const unpinnedPawns = pawns & ~legality.pinned;
+        auto const singlePushes = shiftBy(pawns & (~legality.pinned | Files[king]), offset) & emptySquares();
+        auto const doublePushes = shiftBy(singlePushes & doublePushRank, offset) & emptySquares() & legality.evasions;
+
+        auto count = pawnMoves(singlePushes & legality.evasions) + popcount(doublePushes)
+            + pawnMoves(shiftBy(unpinnedPawns & ~FILES[0], westOffset) & enemies & legality.evasions)
+            + pawnMoves(shiftBy(unpinnedPawns & ~FILES[SquaresPerRank - 1], eastOffset) & enemies & legality.evasions);
+
+        for(auto pinnedPawns = pawns & legality.pinned; pinnedPawns; pinnedPawns &= pinnedPawns - 1)
+        {
+            auto const pawn = ffs(pinnedPawns);
+            count += pawnMoves(PawnAttacks[color][pawn] & enemies & legality.evasions & Line[king][pawn]);
+        }
+
+        // pinned knights cannot move, pinned sliders stay on their pin line
+        for(auto knights = piecesOf(color, KNIGHT) & ~legality.pinned; knights; knights &= knights - 1)
+        {
+            count += popcount(KnightAttacks[ffs(knights)] & notOwn & legality.evasions);
+        }
+
+        for(auto sliders = piecesOf(color) & diagonalSliders(); sliders; sliders &= sliders - 1)
+        {
+            auto const slider = ffs(sliders);
+            auto const line = (A1 << slider) & legality.pinned ? Line[king][slider] : ~EMPTY;
+            count += popcount(bishopAttacks(slider, occupied) & notOwn & legality.evasions & line);
+        }
+
+        for(auto sliders = piecesOf(color) & orthogonalSliders(); sliders; sliders &= sliders - 1)
+        {
+            auto const slider = ffs(sliders);
+            auto const line = (A1 << slider) & legality.pinned ? Line[king][slider] : ~EMPTY;
+            count += popcount(rookAttacks(slider, occupied) & notOwn & legality.evasions & line);
+        }
+
+        // the king must not step onto squares attacked through its own square
+        auto const withoutKing = occupied ^ (A1 << king);
+        auto danger = pawnAttackSet<other>(piecesOf(other, PAWN)) | KingAttacks[ffs(piecesOf(other, KING))]
+            | detail::bishopAttacksSet(enemies & diagonalSliders(), withoutKing)
+            | detail::rookAttacksSet(enemies & orthogonalSliders(), withoutKing);
+        for(auto knights = piecesOf(other, KNIGHT); knights; knights &= knights - 1)
         {
-            case PAWN:
+            danger |= KnightAttacks[ffs(knights)];
+        }
+        count += popcount(KingAttacks[king] & notOwn & ~danger);
+
+        // castling paths are only attacked through the king's square if the king is in check
+        auto constexpr shift = color * 56;
+        count += (castlingRights & (1 << (color << 1)))
+            && (((emptySquares() >> shift) & (F1|G1)) == (F1|G1))
+            && !(danger & ((E1 | F1 | G1) << shift));
+        count += (castlingRights & (2 << (color << 1)))
+            && (((emptySquares() >> shift) & (B1|C1|D1)) == (B1|C1|D1))
+            && !(danger & ((C1 | D1 | E1) << shift));
+
+        // en passant removes two pieces from the king's lines => verify after the move
+        if(enPassant)
+        {
+            auto const target = ffs(enPassant);
+            auto & undoState = undoStateAtDepth[depth];
+            auto attackers = shiftBy(shiftBy(pawns & ~FILES[0], westOffset) & enPassant, -westOffset)
+                | shiftBy(shiftBy(pawns & ~FILES[SquaresPerRank - 1], eastOffset) & enPassant, -eastOffset);
+            for(; attackers; attackers &= attackers - 1)
             {
-                auto reachable = PawnPushes[sideToMove][origin] & empty;        
-                // double pushes from starting position
-                if(sideToMove == WHITE)
-                {
-                    reachable |= (reachable << SquaresPerRank) & RANKS[3];
-                }
-                else
-                {
-                    reachable |= (reachable >> SquaresPerRank) & RANKS[4];
-                }
-                return reachable & empty;
+                auto const move = Move(ffs(attackers), target, Move::EN_PASSANT);
+                makeMove(move, undoState);
+                count += !isAttacked(other, king);
+                unmakeMove(move, undoState);
             }
-            case KNIGHT:
-                return KnightAttacks[origin] & empty;
-            case BISHOP:
-                return DiagonalAttacks[origin][pext(~empty, DiagonalMasks[origin])] & empty;
-            case ROOK:        
-                return (RankAttacks[origin][pext(~empty, RankMasks[origin])]
-                        | FileAttacks[origin][pext(~empty, FileMasks[origin])])
-                        & empty;        
-            case QUEEN:
-                return (DiagonalAttacks[origin][pext(~empty, DiagonalMasks[origin])]
-                        | RankAttacks[origin][pext(~empty, RankMasks[origin])]
-                        | FileAttacks[origin][pext(~empty, FileMasks[origin])])
-                        & empty;  
-            case KING:
-                return KingAttacks[origin] & empty;
-            default:
-                throw std::runtime_error("unknown piece type: " + std::to_string(piece));      
         }
+
+        return count;
     }
 
-    void Position::storePrincipalVariation(HashEntry const hashEntry, int const depth)
+    void Position::storePrincipalVariation(Move const move, int const depth)
     {
-        auto firstMovePointer = &principalVariation[depth * MAX_DEPTH_ARRAY_SIZE - (depth * (depth - 1)) / 2];
-        auto const lengthOfPrincipalVariation = MAX_DEPTH_ARRAY_SIZE - depth;
-        *firstMovePointer = hashEntry;          
-        std::copy(
-            firstMovePointer + lengthOfPrincipalVariation,
-            firstMovePointer + lengthOfPrincipalVariation * 2 - 1, 
-            firstMovePointer + 1);            
+        // the line of each ply is followed by the (shorter) line of the next ply,
+        // only the moves the child line actually holds are copied
+        auto const line = &principalVariation[depth * MAX_DEPTH_ARRAY_SIZE - (depth * (depth - 1)) / 2];
+        auto const childLine = line + MAX_DEPTH_ARRAY_SIZE - depth;
+        auto const childLength = principalVariationLength[depth + 1];
+        line[0] = move;
+        std::copy_n(childLine, childLength, line + 1);
+        principalVariationLength[depth] = childLength + 1;
     }
 
     bool Position::checkAbortingConditions()
     {
-        if(interruptState == Interrupted)
-        {
-            return true;
-        } 
-
-        auto const now = std::chrono::steady_clock::now();
-        if(now > evaluationTargetTimePoint)
-        {
-            interruptState = Interrupted;
-            return true;
-        }
-        return false;
+        // set by interrupt() and by the timer of evaluateRecursively
+        return interruptState.load(std::memory_order_relaxed) == Interrupted;
     }
    
     void Position::sendInfo()
@@ -1774,119 +2310,20 @@ namespace spezi
         auto const origin = uciNotation[0] - 'a' + (uciNotation[1] - '1') * SquaresPerRank;
         auto const target = uciNotation[2] - 'a' + (uciNotation[3] - '1') * SquaresPerRank; 
 
-        auto const from = A1 << origin;
-        auto const to = A1 << target;
-
-        auto const movedPiece = individualPieces[PAWN] & from ? PAWN
-                                : individualPieces[KNIGHT] & from ? KNIGHT
-                                : individualPieces[BISHOP] & from ? BISHOP
-                                : individualPieces[ROOK] & from ? ROOK
-                                : individualPieces[QUEEN] & from ? QUEEN
-                                : KING;
-        auto const capturedPiece = (individualPieces[PAWN] & to) || (enPassant && target == ffs(enPassant))? PAWN
-                                : individualPieces[KNIGHT] & to ? KNIGHT
-                                : individualPieces[BISHOP] & to ? BISHOP
-                                : individualPieces[ROOK] & to ? ROOK
-                                : individualPieces[QUEEN] & to ? QUEEN
-                                : KING;
+        auto const movedPiece = static_cast<Piece>(pieceOn[origin] % NumberOfPieceTypes);
         auto const promotedPiece = uciNotation.size() == 4 ? KING
                                 : uciNotation[4] == 'n' ? KNIGHT
                                 : uciNotation[4] == 'b' ? BISHOP
                                 : uciNotation[4] == 'r' ? ROOK
                                 : uciNotation[4] == 'q' ? QUEEN
                                 : KING;
+        auto const type = promotedPiece != KING ? Move::PROMOTION
+                        : (movedPiece == PAWN && enPassant && target == ffs(enPassant)) ? Move::EN_PASSANT
+                        : (movedPiece == KING && (target - origin == 2 || origin - target == 2)) ? Move::CASTLING
+                        : Move::NORMAL;
 
-        zKey ^= PieceKeys[sideToMove][movedPiece][origin];
-        allPieces[sideToMove] ^= from;
-        allPieces[sideToMove] ^= to;
-        individualPieces[movedPiece] ^=from;
-        empty ^= from;
-
-        zKey ^= PieceKeys[sideToMove]
-            [(promotedPiece == KING) * movedPiece + (promotedPiece!=KING) * promotedPiece][target];
-        individualPieces[(promotedPiece == KING) * movedPiece + (promotedPiece!=KING) * promotedPiece] ^= to;
-
-        if(capturedPiece != KING)
-        {
-            halfMoves = 0;
-
-            if(enPassant && target == ffs(enPassant))
-            {
-                auto const pawn = target + ((sideToMove << 1) - 1) * SquaresPerRank;
-                zKey ^= PieceKeys[(sideToMove + 1) % 2][capturedPiece][pawn];
-                allPieces[(sideToMove + 1) % 2] ^= (A1 << pawn); 
-                individualPieces[capturedPiece] ^= (A1 << pawn);
-                empty ^= to;
-                empty ^= (A1 << pawn);
-            }
-            else
-            {
-                zKey ^= PieceKeys[(sideToMove + 1) % 2][capturedPiece][target];
-                allPieces[(sideToMove + 1) % 2] ^= to;
-                individualPieces[capturedPiece] ^= to; 
-            }
-        }
-        else
-        {
-            empty ^= to;
-            halfMoves += movedPiece == PAWN ? -halfMoves : 1; 
-
-            if(movedPiece == KING)
-            {
-                if(origin == e1)
-                {
-                    if(target == g1)
-                    {
-                        auto const rookSquares = F1 | H1;
-                        allPieces[WHITE] ^= rookSquares;
-                        individualPieces[ROOK] ^= rookSquares;
-                        empty ^= rookSquares;
-                        zKey ^= PieceKeys[WHITE][ROOK][f1];
-                        zKey ^= PieceKeys[WHITE][ROOK][h1];
-                    }
-                    else if (target == c1)
-                    {
-                        auto const rookSquares = A1 | D1;
-                        allPieces[WHITE] ^= rookSquares;
-                        individualPieces[ROOK] ^= rookSquares;
-                        empty ^= rookSquares;
-                        zKey ^= PieceKeys[WHITE][ROOK][a1];
-                        zKey ^= PieceKeys[WHITE][ROOK][d1];
-                    }
-                }
-                else if(origin == e8)
-                {
-                    if(target == g8)
-                    {
-                        auto const rookSquares = F8 | H8;
-                        allPieces[BLACK] ^= rookSquares;
-                        individualPieces[ROOK] ^= rookSquares;
-                        empty ^= rookSquares;
-                        zKey ^= PieceKeys[BLACK][ROOK][f8];
-                        zKey ^= PieceKeys[BLACK][ROOK][h8];
-                    }
-                    else if(target == c8)
-                    {
-                        auto const rookSquares = A8 | D8;
-                        allPieces[BLACK] ^= rookSquares;
-                        individualPieces[ROOK] ^= rookSquares;
-                        empty ^= rookSquares;
-                        zKey ^= PieceKeys[BLACK][ROOK][A8];
-                        zKey ^= PieceKeys[BLACK][ROOK][D8];
-                    }
-                }
-            }
-        }
-
-        zKey ^= CastlingKeys[castlingRights];
-        castlingRights &= castlingCaptureUpdateFlags(from, to);
-        zKey ^= CastlingKeys[castlingRights];
-        
-        zKey ^= enPassant ? EnPassantKeys[ffs(enPassant) % SquaresPerRank] : ZKey {0};
-      
-        enPassant = (movedPiece == PAWN) ? (A1 << ((ffs(from) + ffs(to)) >> 1)) & Files[origin] : EMPTY;
-
-        zKey ^= enPassant ? EnPassantKeys[ffs(enPassant) % SquaresPerRank] : ZKey {0};
+        UndoState undoState;
+        makeMove(Move(origin, target, type, promotedPiece != KING ? promotedPiece : KNIGHT), undoState);
 
         fullMoves += sideToMove;
         sideToMove = static_cast<Color>(sideToMove ^ BLACK);
@@ -4,6 +4,9 @@
 #include "Color.hpp"
 #include "HashTable.hpp"
 #include "Mobility.hpp"
+#include "Move.hpp"
+#include "NeuralNetwork.hpp"
+#include "PieceBitBoards.hpp"
 #include "Piece.hpp"
 #include "Square.hpp"
 #include "TimeManagement.hpp"
@@ -12,16 +15,32 @@
 #include <array>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+// take moves back by copying the saved board state instead of reverting every change
+// (XOR make/unmake), compare both with benchmark/MakeUnmakeBenchmark.cpp
+//#define COPY_MAKE
+
 namespace spezi
 {    
     MilliSquare constexpr LOSS[NumberOfColors] = {-MateValue, MateValue};   
     MilliSquare constexpr DRAW = 0;
 
+    // the search is compiled once per node type: full-width alpha-beta nodes, quiescence nodes
+    // (captures and check evasions only) and perft nodes (every legal move, no pruning or evaluation)
+    enum SearchType
+    {
+        MAIN_SEARCH,
+        QUIESCENCE_SEARCH,
+        PERFT_SEARCH
+    };
+
     struct EvaluationParameters
     {
         int wtime = -1;
@@ -33,6 +52,7 @@ namespace spezi
         int nodes = -1;
         int mate = -1;
         int movetime = -1;
+        bool perft = false;
     };
 
     struct EvaluationStatistics
@@ -43,11 +63,72 @@ namespace spezi
         int64_t numberOfNodes;
         int64_t numberOfQuiescenceNodes;
         float seconds;
+        // nodes of all depths searched (the fields above are those of the last completed depth)
+        int64_t totalNumberOfNodes;
+    };
+
+    // Attack maps of one node, filled on demand at most once per node and side.
+    // Safe mobility counts the squares attacked by knights, bishops, rooks and queens
+    // that are neither occupied by own pieces nor covered by enemy pawns.
+    // Pinned pieces (of the side to move) may only move along the line through their king,
+    // all pieces but the king may only move to evasion squares (everything if not in check,
+    // capturing or blocking a single checker, nothing in double check).
+    struct AttackMaps
+    {
+        // valid: bit 1 << color once the attacks of that side are computed, PINS once the pins
+        // and evasions are
+        static unsigned char constexpr PINS = 1 << NumberOfColors;
+
+        BitBoard byPiece[NumberOfColors][NumberOfPieceTypes];
+        BitBoard bySide[NumberOfColors];
+        BitBoard pinned;
+        BitBoard evasions;
+        Square safeMobility[NumberOfColors];
+        unsigned char valid = 0;
+    };
+
+    // Search state of one ply, one cache line per ply. alphaBeta holds alpha of the side to move
+    // and beta (the alpha of the other side), indexed by color like LOSS.
+    struct alignas(64) SearchPly
+    {
+        HashEntry hashEntry;
+        int64_t numberOfNodes = 0;
+        MilliSquare alphaBeta[NumberOfColors] = {};
+        // pieces giving check to the side to move, found once when the node is entered
+        BitBoard checkers = EMPTY;
+    };
+
+    // the board without its mailbox, copied as a whole by copy-make
+    // (96 bytes, 56 bytes with QUAD_BITBOARD)
+    struct BoardState : PieceSets
+    {
+        ZKey zKey = 0;
+        BitBoard enPassant = EMPTY;
+        int halfMoves = 0;
+        unsigned char castlingRights = 0xF;
     };
 
+    // everything a Move does not tell about the position it was made in
+#ifdef COPY_MAKE
+    struct UndoState
+    {
+        BoardState board;
+        Piece captured;     // KING: no piece captured
+    };
+#else
+    struct UndoState
+    {
+        ZKey zKey;
+        BitBoard enPassant;
+        int halfMoves;
+        unsigned char castlingRights;
+        Piece captured;     // KING: no piece captured
+    };
+#endif
+
     constexpr char STARTING_FEN[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
-    class Position
+    class Position : BoardState
     {
     public:
         Position() = delete;
@@ -63,10 +144,24 @@ namespace spezi
         void setMaxNumberOfNullMoves(unsigned int maxNumberOfNullMoves);
         void setMaxQuiescenceDepth(unsigned int quiescenceDepth);
         void setSuppressPv(bool suppressPv);
+        void setDynamicMobilityWeight(unsigned int weight);
+        void setNetworkFile(std::string const & fileName);
+        void setUseNeuralNetwork(bool useNetwork);
+        void setPerftHashTableSize(unsigned int megaByte);
+        void setPerftThreads(unsigned int threads);
+        void setUseOpeningBook(bool useBook);
         void clearHashTable();
+        // marks the next search as running before it starts, so that an interrupt is not lost
+        void prepareSearch();
+        // stops the running (or prepared) search after depth 1, returns right away
         void interrupt();
+        // the next search ponders: no time limit until ponderhit, no bestmove before stop or ponderhit
+        void ponder();
+        // starts the clock of the ponder search with the time its parameters allocate
+        void ponderhit();
 
         std::string getZKey() const;
+        std::string getFen() const;
         std::string getBoardDisplay(int indent = 0) const;
         std::string getPrincipalVariation() const;
         std::string getPrincipalVariationII() const;
@@ -75,36 +170,85 @@ namespace spezi
         MilliSquare evaluateStatically() const;       
         MilliSquare pawnUnitsOnBoard() const; 
 
+        // number of leaf nodes of the legal move tree to the given depth, reported per root move
+        // if dividing; counts the last ply without making its moves
+        int64_t perft(int depth, bool divide);
+
+        // the legal moves of the side to move (the root moves of perft 1, unreported)
+        std::vector<Move> legalMoves();
+
+        bool isAttacked(Color attacking, Square square);
+
+        // the move primitives of the search: the side to move is not switched, unmakeMove
+        // restores the position before makeMove
+        void makeMove(Move move, UndoState & undoState);
+
+        void unmakeMove(Move move, UndoState const & undoState);
+
     private:
+        template<SearchType searchType>
         void evaluate(int depth);
 
         bool repetition();
 
-        bool isAttacked(Color attacking, Square square);
+        void putPiece(Color color, Piece piece, Square square);
+
+        void removePiece(Square square);
+
+        void movePiece(Square origin, Square target);
 
+        BitBoard attackersTo(Color attacking, Square square) const;
+
+        void computeAttackMaps(AttackMaps & attackMaps, Color side) const;
+
+        BitBoard attackedBy(AttackMaps & attackMaps, Color side) const;
+
+        AttackMaps const & pinsAndEvasions(int depth);
+
+        MilliSquare evaluateStatically(AttackMaps & attackMaps) const;
+
+        MilliSquare evaluateNeuralNetwork(int depth);
+
+        template<SearchType searchType>
         bool evaluateHashMove(int depth);
 
         bool evaluateNullMove(int depth);
 
+        template<SearchType searchType>
+        bool evaluateCaptures(int depth);
+
+        template<SearchType searchType, Color color>
         bool evaluateCaptures(int depth);
 
+        // captures of the piece on target by the given attackers
+        template<SearchType searchType, Color color, Piece piece>
+        bool evaluateCapturesBy(int depth, ZKey zKeyAtEntry, Square target, BitBoard attackers);
+
+        template<SearchType searchType>
+        bool evaluateNonCaptures(int depth);
+
+        template<SearchType searchType, Color color>
         bool evaluateNonCaptures(int depth);
 
-        bool updateWindowOrCutoff(
-            ZKey originalZKey,
-            int depth,
-            unsigned char originalCastling,
-            BitBoard originalEnPassant,
-            Square origin, 
-            Square target,
-            Piece moved,
-            Piece captured = KING,
-            Piece promoted = KING,            
-            unsigned char castlingUpdate = 0xFu);
+        template<SearchType searchType, Color color, Piece piece>
+        bool evaluateNonCapturesBy(int depth, ZKey zKeyAtEntry);
+
+        bool updateWindowOrCutoff(ZKey originalZKey, int depth, Move move);
+
+        template<SearchType searchType, Color color>
+        bool updateWindowOrCutoff(ZKey originalZKey, int depth, Move move);
+
+        template<Piece piece>
+        BitBoard generateNonCaptureSquares(Square origin) const;
+
+        // number of legal moves, the same moves evaluateCaptures and evaluateNonCaptures generate
+        template<Color color>
+        int countLegalMoves(int depth);
 
-        BitBoard generateNonCaptureSquares(Piece piece, Square origin) const;
+        // leaf nodes below the current position, root moves recorded in perftRootMoves
+        int64_t countLeafNodes(int depth);
 
-        void storePrincipalVariation(HashEntry hashEntry, int depth);
+        void storePrincipalVariation(Move move, int depth);
 
         bool checkAbortingConditions();
 
@@ -112,35 +256,22 @@ namespace spezi
 
         bool foundPositionInOpeningBook();
 
-        BitBoard empty = A3|B3|C3|D3|E3|F3|G3|H3|A4|B4|C4|D4|E4|F4|G4|H4
-                        |A5|B5|C5|D5|E5|F5|G5|H5|A6|B6|C6|D6|E6|F6|G6|H6;
-        BitBoard allPieces[NumberOfColors] =
-        {
-            A1|B1|C1|D1|E1|F1|G1|H1|A2|B2|C2|D2|E2|F2|G2|H2,    // white
-            A8|B8|C8|D8|E8|F8|G8|H8|A7|B7|C7|D7|E7|F7|G7|H7     // black
-        };
-        BitBoard individualPieces[NumberOfPieceTypes] = 
-        {
-            A2|B2|C2|D2|E2|F2|G2|H2|A7|B7|C7|D7|E7|F7|G7|H7,    // pawns
-            B1|G1|B8|G8,                                        // knights
-            C1|F1|C8|F8,                                        // bishops
-            A1|H1|A8|H8,                                        // rooks
-            D1|D8,                                              // queens
-            E1|E8,                                              // kings
-        };
+        // mailbox (color * NumberOfPieceTypes + piece per square, 2 * NumberOfPieceTypes if empty)
+        // and unordered per-side piece lists, pieceIndex locates a square in its piece list;
+        // kept in sync with the bitboards by every make and unmake
+        static int constexpr MAX_PIECES_PER_SIDE = 16;
+        std::array<unsigned char, NumberOfSquares> pieceOn;
+        std::array<unsigned char, NumberOfSquares> pieceIndex;
+        std::array<std::array<unsigned char, MAX_PIECES_PER_SIDE>, NumberOfColors> pieceList;
+        std::array<unsigned char, NumberOfColors> pieceCount;
 
-        int halfMoves = 0;
         int fullMoves = 0;
 
-        unsigned char castlingRights = 0xF;
-
         Color sideToMove = WHITE;
-        BitBoard enPassant = EMPTY;
-
-        ZKey zKey;
 
         int maxDepth = 0;
         int maxQuiescenceDepth = 8;
+        int dynamicMobilityWeight = 0;
         int nullMoveDepth = 0;
 
         int nullMovesOnBranch = 0;
@@ -168,14 +299,20 @@ namespace spezi
         static int constexpr MAX_QUIESCENCE_DEPTH = 64;         
         
         static int constexpr MAX_DEPTH_ARRAY_SIZE = MAX_DEPTH + MAX_QUIESCENCE_DEPTH + 1;
-        std::array<std::array<MilliSquare, MAX_DEPTH_ARRAY_SIZE>, NumberOfColors> alphaBetaAtDepth;
-        std::array<int64_t, MAX_DEPTH_ARRAY_SIZE> numberOfNodesAtDepth;
-        std::array<HashEntry, MAX_DEPTH_ARRAY_SIZE> hashEntryAtDepth;
+        std::array<SearchPly, MAX_DEPTH_ARRAY_SIZE> searchStack;
+        std::array<AttackMaps, MAX_DEPTH_ARRAY_SIZE> attackMapsAtDepth;
+        std::array<UndoState, MAX_DEPTH_ARRAY_SIZE> undoStateAtDepth;
 
         static int constexpr PRINCIPAL_VARIATION_ARRAY_SIZE = (MAX_DEPTH_ARRAY_SIZE * (MAX_DEPTH_ARRAY_SIZE + 1)) / 2;
-        std::array<HashEntry, PRINCIPAL_VARIATION_ARRAY_SIZE> principalVariation;
+        std::array<Move, PRINCIPAL_VARIATION_ARRAY_SIZE> principalVariation;
+        // one more than plies: the line below the last ply is always empty
+        std::array<unsigned char, MAX_DEPTH_ARRAY_SIZE + 1> principalVariationLength {};
         bool suppressFaultyPv {false};
 
+        NeuralNetwork neuralNetwork;
+        bool useNeuralNetwork {false};
+        std::array<Accumulator, MAX_DEPTH_ARRAY_SIZE> accumulatorAtDepth;
+
         static int constexpr MB = 1 << 20;
         HashTable transpositionTable {MB * 1};
         PrincipalVariationTable principalVariationTable {1024, 8};
@@ -185,7 +322,24 @@ namespace spezi
 
         EvaluationParameters evaluationParameters;
 
+        // Position::perft only: bulk counting of the last ply, the perft hash table (shared with
+        // the perft threads, none if empty) and the node counts per root move. PERFT_SEARCH run
+        // by evaluateRecursively keeps making every move.
+        bool perftShortcuts {false};
+        std::shared_ptr<PerftTable> perftTable;
+        unsigned int perftThreads {1};
+        std::vector<std::pair<Move, int64_t>> perftRootMoves;
+
         TimePoint evaluationTargetTimePoint;
+        bool useOpeningBook {true};
+
+        // ponder state, shared with the thread calling ponderhit; ponderTimeAllocation is set
+        // by a running ponder search with a time limit only
+        std::mutex ponderMutex;
+        std::condition_variable ponderCondition;
+        bool pondering {false};
+        TimePoint::duration ponderTimeAllocation {TimePoint::duration::max()};
+        TimePoint ponderHitTargetTimePoint {TimePoint::max()};
 
         static MilliSeconds constexpr INTERRUPT_INTERVAL {10}; 
       
@@ -198,6 +352,13 @@ namespace spezi
 
         std::atomic<InterruptState> interruptState {Idle};
 
+        // the search only polls interruptState, the timer sets it when the time is up
+        DeadlineTimer deadlineTimer {[this]
+        {
+            auto busy = Busy;
+            interruptState.compare_exchange_strong(busy, Interrupted);
+        }};
+
         static MilliSeconds constexpr INFO_INTERVAL {1000};
         TimePoint lastInfoSentTimePoint;
 
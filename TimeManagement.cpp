@@ -35,4 +35,63 @@ namespace spezi
         auto const timeLeft = std::chrono::duration_cast<MilliSeconds>(targetTimePoint - std::chrono::steady_clock::now());
         return timeLeft >= timeSpentAtPreviousDepth * 10;
     }
+
+    DeadlineTimer::DeadlineTimer(std::function<void()> onDeadline)
+    : onDeadline(std::move(onDeadline))
+    {
+    }
+
+    DeadlineTimer::~DeadlineTimer()
+    {
+        if(!thread.joinable())
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quitting = true;
+        }
+        condition.notify_one();
+        thread.join();
+    }
+
+    void DeadlineTimer::setDeadline(TimePoint const newDeadline)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            deadline = newDeadline;
+            if(deadline != TimePoint::max() && !thread.joinable())
+            {
+                thread = std::thread(&DeadlineTimer::run, this);
+            }
+        }
+        condition.notify_one();
+    }
+
+    void DeadlineTimer::cancel()
+    {
+        // onDeadline is called with the mutex held, so it is done once the mutex is ours
+        std::lock_guard<std::mutex> lock(mutex);
+        deadline = TimePoint::max();
+    }
+
+    void DeadlineTimer::run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(!quitting)
+        {
+            auto const waitUntil = deadline;
+            if(waitUntil == TimePoint::max())
+            {
+                condition.wait(lock);
+            }
+            else if(condition.wait_until(lock, waitUntil) == std::cv_status::timeout
+                && deadline != TimePoint::max() && std::chrono::steady_clock::now() >= deadline)
+            {
+                deadline = TimePoint::max();
+                onDeadline();
+            }
+        }
+    }
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 
 namespace spezi
 {
@@ -10,4 +14,32 @@ namespace spezi
     TimePoint getTargetTime(MilliSeconds timeLeft, MilliSeconds increment, MilliSeconds movetime, int movesPlayed);
 
     bool enoughTimeForDeeperSearch(TimePoint targetTimePoint, MilliSeconds timeSpentAtPreviousDepth);
+
+    // calls onDeadline on a thread of its own once the deadline set has passed, unless cancelled
+    // before; the thread is started by the first deadline before TimePoint::max() and parked
+    // without a deadline until the timer is destroyed
+    class DeadlineTimer
+    {
+    public:
+        explicit DeadlineTimer(std::function<void()> onDeadline);
+        DeadlineTimer(DeadlineTimer const & other) = delete;
+        DeadlineTimer & operator=(DeadlineTimer const & other) = delete;
+        ~DeadlineTimer();
+
+        // may be called from any thread, TimePoint::max() is no deadline
+        void setDeadline(TimePoint deadline);
+
+        // returns when onDeadline has either been called or will not be called anymore
+        void cancel();
+
+    private:
+        void run();
+
+        std::function<void()> onDeadline;
+        std::mutex mutex;
+        std::condition_variable condition;
+        TimePoint deadline {TimePoint::max()};
+        bool quitting {false};
+        std::thread thread;
+    };
 }
\ No newline at end of file
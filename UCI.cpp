@@ -1,5 +1,7 @@
 #include "UCI.hpp"
 
+#include "Bench.hpp"
+
 #include <algorithm>
 #include <iostream>
 #include <mutex>
@@ -15,7 +17,7 @@ namespace spezi
         std::vector<std::string> const guiCommands
         {            
             "uci", "debug", "isready", "setoption", "ucinewgame",
-            "position", "go", "stop", "ponderhit", "quit"
+            "position", "go", "stop", "ponderhit", "quit", "bench"
         };
 
         std::vector<std::string> splitLine(std::string line)
@@ -35,6 +37,21 @@ namespace spezi
         }
     }
 
+    UCI::UCI()
+    : searchThread(&UCI::searchLoop, this)
+    {}
+
+    UCI::~UCI()
+    {
+        interrupt();
+        {
+            std::lock_guard<std::mutex> lock(searchMutex);
+            quitting = true;
+        }
+        searchCondition.notify_one();
+        searchThread.join();
+    }
+
     void UCI::run()
     {
         while(uciState != Ended)
@@ -124,6 +141,13 @@ namespace spezi
             return;
         }
        
+        // ponderhit turns the running ponder search into a regular one
+        if(args[numberOfToken] == "ponderhit")
+        {
+            ponderhit();
+            return;
+        }
+
         // any other command will have to interrupt running calculations, so do it once here
 
         interrupt();
@@ -177,6 +201,9 @@ namespace spezi
         else if(args[numberOfToken] == "go" && args.size() >= numberOfToken + 2)
         {
             goParameters = EvaluationParameters{};
+            perftDepth = 0;
+            perftDivide = false;
+            goPonder = false;
             auto iter = args.cbegin() + numberOfToken + 1; 
             while(iter!=args.cend())
             {
@@ -228,6 +255,14 @@ namespace spezi
                 {
                     infinite();
                 }
+                else if(*iter == "perft" && ++iter != args.cend())
+                {
+                    perft(std::stoul(*iter));
+                }
+                else if(*iter == "divide" && ++iter != args.cend())
+                {
+                    divide(std::stoul(*iter));
+                }
                 else
                 {
                     throw std::runtime_error("could not process go command");
@@ -242,14 +277,14 @@ namespace spezi
         {
             stop();
         }
-        else if(args[numberOfToken] == "ponderhit")
-        {
-            ponderhit();
-        }
         else if(args[numberOfToken] == "quit")
         {
             quit();
         }
+        else if(args[numberOfToken] == "bench")
+        {
+            bench(args.cbegin() + numberOfToken + 1, args.cend());
+        }
     } 
 
     void UCI::uci()
@@ -263,6 +298,14 @@ namespace spezi
         writeCommandToGui("option name QDepth type spin default 8 min 0 max 64");
         // Suppress faulty PV 
         writeCommandToGui("option name SuppressPV type check default false");
+        writeCommandToGui("option name DynamicMobility type spin default 0 min 0 max 100");
+        writeCommandToGui("option name EvalFile type string default <empty>");
+        writeCommandToGui("option name UseNNUE type check default false");
+        writeCommandToGui("option name SliderAttacks type combo default auto var auto var pext var magic var portable");
+        writeCommandToGui("option name PerftThreads type spin default 1 min 1 max 256");
+        writeCommandToGui("option name PerftHash type spin default 0 min 0 max 4096");
+        writeCommandToGui("option name OwnBook type check default true");
+        writeCommandToGui("option name Ponder type check default false");
         writeCommandToGui("uciok");
     
         uciState = Ready;
@@ -296,6 +339,38 @@ namespace spezi
         {
             p.setSuppressPv(value != "false");
         }
+        else if(name == "DynamicMobility")
+        {
+            p.setDynamicMobilityWeight(std::stoul(value));
+        }
+        else if(name == "EvalFile")
+        {
+            p.setNetworkFile(value);
+        }
+        else if(name == "UseNNUE")
+        {
+            p.setUseNeuralNetwork(value != "false");
+        }
+        else if(name == "SliderAttacks")
+        {
+            sliderAttacks = parseSliderAttacks(value);
+        }
+        else if(name == "PerftThreads")
+        {
+            p.setPerftThreads(std::stoul(value));
+        }
+        else if(name == "PerftHash")
+        {
+            p.setPerftHashTableSize(std::stoul(value));
+        }
+        else if(name == "OwnBook")
+        {
+            p.setUseOpeningBook(value != "false");
+        }
+        else if(name == "Ponder")
+        {
+            /* nothing to do here, the GUI decides when to go ponder */
+        }
     }
     
     void UCI::ucinewgame()
@@ -315,22 +390,37 @@ namespace spezi
     {
         uciState = Busy;
 
-        auto evaluateAndCatchExceptions = [this](EvaluationParameters const & params)
+        // the search thread reads the go parameters only while searching, so they are not
+        // written concurrently: any command interrupts (and waits for) a running search first
+        // before the search thread starts, so that an early ponderhit or stop is not lost
+        if(goPonder && !perftDepth)
         {
-            try
-            {
-                p.evaluateRecursively(params); 
-            }
-            catch(std::exception const & e)
-            {
-                writeCommandToGui(e.what());
-            }
-        };         
+            p.ponder();
+        }
+        p.prepareSearch();
 
-        auto evaluationThread = std::thread(evaluateAndCatchExceptions, goParameters);
-        evaluationThread.detach();
+        {
+            std::lock_guard<std::mutex> lock(searchMutex);
+            searching = true;
+        }
+        searchCondition.notify_one();
     }
     
+    void UCI::bench(std::vector<std::string>::const_iterator begin,
+                        std::vector<std::string>::const_iterator const end)
+    {
+        auto const depth = begin != end ? std::stoi(*begin++) : 4;
+        auto const threads = begin != end ? std::stoi(*begin++) : 1;
+        auto const hashMegaBytes = begin != end ? std::stoul(*begin++) : 16;
+
+        if(threads != 1)
+        {
+            throw std::runtime_error("bench supports one thread only, the search is single-threaded");
+        }
+
+        spezi::bench(depth, hashMegaBytes, writeCommandToGui);
+    }
+
     void UCI::stop()
     {
         /* nothing to do here, interrupt is already handled */
@@ -338,7 +428,10 @@ namespace spezi
     
     void UCI::ponderhit()
     {
-
+        if(uciState == Busy)
+        {
+            p.ponderhit();
+        }
     }
     
     void UCI::quit()
@@ -354,7 +447,7 @@ namespace spezi
 
     void UCI::ponder()
     {
-
+        goPonder = true;
     }
 
     void UCI::wtime(int const milliseconds)
@@ -407,22 +500,74 @@ namespace spezi
         /* nothing to do here, infinite search is the default */
     }
 
+    void UCI::perft(int const plies)
+    {
+        perftDepth = plies;
+    }
+
+    void UCI::divide(int const plies)
+    {
+        perftDepth = plies;
+        perftDivide = true;
+    }
+
     void UCI::interrupt()
     {
-        if(uciState == Busy) 
+        if(uciState != Busy)
+        {
+            return;
+        }
+
+        // go has prepared the search, so the interrupt holds even if the search thread has
+        // not started it yet; wait until the search thread has sent bestmove
+        p.interrupt();
+        std::unique_lock<std::mutex> lock(searchMutex);
+        searchCondition.wait(lock, [this]{ return !searching; });
+        uciState = Ready;
+    }
+
+    void UCI::searchLoop()
+    {
+        std::unique_lock<std::mutex> lock(searchMutex);
+        while(true)
         {
-            p.interrupt();
-            uciState = Ready;
+            searchCondition.wait(lock, [this]{ return searching || quitting; });
+            if(quitting)
+            {
+                return;
+            }
+
+            lock.unlock();
+            try
+            {
+                if(perftDepth)
+                {
+                    p.perft(perftDepth, perftDivide);
+                }
+                else
+                {
+                    p.evaluateRecursively(goParameters); 
+                }
+            }
+            catch(std::exception const & e)
+            {
+                writeCommandToGui(e.what());
+            }
+            lock.lock();
+
+            searching = false;
+            searchCondition.notify_all();
         }
     }
 
     std::string UCI::fen(std::vector<std::string>::const_iterator & firstFenSection)
     {
-        return *firstFenSection + " " +
-               *(++firstFenSection) + " " +
-               *(++firstFenSection) + " " +
-               *(++firstFenSection) + " " +
-               *(++firstFenSection) + " " +
-               *(++firstFenSection);
+        // one section at a time, the operands of + are not evaluated in any particular order
+        auto fen = *firstFenSection;
+        for(auto section = 1; section < 6; ++section)
+        {
+            fen += " " + *(++firstFenSection);
+        }
+        return fen;
     }
 }
\ No newline at end of file
@@ -3,14 +3,26 @@
 #include "Position.hpp"
 
 #include <array>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace spezi
 {
     class UCI
     {
         public:
+            UCI();
+            UCI(UCI const & other) = delete;
+            UCI & operator=(UCI const & other) = delete;
+            ~UCI();
+
             void run();
 
+            // non-standard command, also available from the command line: bench [depth] [threads] [hash]
+            static void bench(std::vector<std::string>::const_iterator begin,
+                                std::vector<std::string>::const_iterator end);
+
         private:
             enum UCIState
             {
@@ -54,9 +66,13 @@ namespace spezi
             void mate(int moves);
             void movetime(int milliseconds);
             void infinite();
+            void perft(int plies);
+            void divide(int plies);
 
             // other
             void interrupt();
+            // runs on the search thread: waits for go, searches (or runs perft), reports, waits again
+            void searchLoop();
             // position sub commands 
             std::string fen(std::vector<std::string>::const_iterator & firstFenSection);
      
@@ -66,7 +82,22 @@ namespace spezi
             Position p {STARTING_FEN, writeCommandToGui};
            
             EvaluationParameters goParameters;
+
+            // go perft / go divide instead of a search if not 0
+            int perftDepth {0};
+            bool perftDivide {false};
+
+            // go ponder: search until ponderhit or stop
+            bool goPonder {false};
             
             UCIState uciState {Initial};
+
+            // one search thread for the lifetime of the engine, parked while there is nothing to do;
+            // searching is set by go and cleared by the search thread once bestmove is sent
+            std::mutex searchMutex;
+            std::condition_variable searchCondition;
+            bool searching {false};
+            bool quitting {false};
+            std::thread searchThread;
     };
 }
\ No newline at end of file
@@ -0,0 +1,200 @@
+// Compares the sliding attack lookups: separate rank, file and diagonal tables indexed by
+// [square][pext] (two pext and two lookups per rook) against the packed rook and bishop
+// tables in BitBoardArray.hpp (one pext and one lookup each), the latter with all
+// SliderAttacks (pext, magic and portable). It also compares the union of the attacks of
+// whole rook and bishop sets: one table lookup per piece against the set-wise Kogge-Stone
+// fills (AVX2 if compiled in) of MobilityDetail.hpp. Build it with e.g.
+//
+//   clang++ -std=c++17 -O3 -march=native -I. benchmark/AttackLookupBenchmark.cpp
+//       BitBoard.cpp -o attackLookupBenchmark
+//
+// All lookups have to return identical attacks for all squares and occupancies.
+//
+// usage: attackLookupBenchmark [lookups] [repetitions]
+
+#include "BitBoardArray.hpp"
+#include "Piece.hpp"
+#include "MobilityDetail.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace spezi;
+
+namespace
+{
+    // the tables before packing
+    auto constexpr RankAttacks = detail::collectBitBoards<detail::rankAttack>();
+    BitBoardArray constexpr RankMasks = detail::collectBitBoards(detail::rankMask);
+    auto constexpr FileAttacks = detail::collectBitBoards<detail::fileAttack>();
+    BitBoardArray constexpr FileMasks = detail::collectBitBoards(detail::fileMask);
+    auto constexpr DiagonalAttacks = detail::collectBitBoards<detail::diagonalAttack>();
+    BitBoardArray constexpr DiagonalMasks = detail::collectBitBoards(detail::diagonalMask);
+
+    struct Query
+    {
+        Square square;
+        BitBoard occupied;
+    };
+
+    // orthogonal and diagonal sliders of one side, both included in the occupancy
+    struct SetQuery
+    {
+        BitBoard rooks;
+        BitBoard bishops;
+        BitBoard occupied;
+    };
+
+    BitBoard separateLookup(Query const query)
+    {
+        auto const square = query.square;
+        auto const occupied = query.occupied;
+        return RankAttacks[square][pext(occupied, RankMasks[square])]
+            | FileAttacks[square][pext(occupied, FileMasks[square])]
+            | DiagonalAttacks[square][pext(occupied, DiagonalMasks[square])];
+    }
+
+    BitBoard packedLookup(Query const query)
+    {
+        return rookAttacks(query.square, query.occupied) | bishopAttacks(query.square, query.occupied);
+    }
+
+    BitBoard tableSetLookup(SetQuery const query)
+    {
+        auto result = EMPTY;
+        for(auto rooks = query.rooks; rooks; rooks &= rooks - 1)
+        {
+            result |= rookAttacks(ffs(rooks), query.occupied);
+        }
+        for(auto bishops = query.bishops; bishops; bishops &= bishops - 1)
+        {
+            result |= bishopAttacks(ffs(bishops), query.occupied);
+        }
+        return result;
+    }
+
+    BitBoard koggeStoneSetLookup(SetQuery const query)
+    {
+        return detail::rookAttacksSet(query.rooks, query.occupied) 
+            | detail::bishopAttacksSet(query.bishops, query.occupied);
+    }
+
+    void print(char const * const name, double const nanoseconds, size_t const size = 0)
+    {
+        auto const sizeColumn = size ? std::to_string(size / 1024) + " KB " : std::string();
+        std::cout << std::left << std::setw(36) << name << std::right << std::setw(12) << sizeColumn
+            << std::fixed << std::setprecision(2) << nanoseconds << " ns per lookup" << std::endl;
+    }
+
+    template<typename QueryType, BitBoard lookup(QueryType)>
+    double nanosecondsPerLookup(std::vector<QueryType> const & queries, int const repetitions, BitBoard & checksum)
+    {
+        auto best = std::numeric_limits<double>::max();
+        for(auto repetition = 0; repetition < repetitions; ++repetition)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            for(auto const query : queries)
+            {
+                checksum += lookup(query);
+            }
+            std::chrono::duration<double, std::nano> const elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count() / queries.size());
+        }
+        return best;
+    }
+}
+
+int main(int const argc, char const * const argv[])
+{
+    auto const lookups = argc > 1 ? std::stoi(argv[1]) : 10000000;
+    auto const repetitions = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    // sparse occupancies like in middle games, fixed seed for comparable runs
+    std::mt19937_64 random(20240101);
+    std::vector<Query> queries(lookups);
+    for(auto & query : queries)
+    {
+        query.square = random() % NumberOfSquares;
+        query.occupied = random() & random() & ~(A1 << query.square);
+    }
+
+    // 1-4 rooks and bishops each, rooks and queens / bishops and queens in a middle game
+    std::vector<SetQuery> setQueries(lookups);
+    for(auto & query : setQueries)
+    {
+        auto const pieces = [&random](int const count)
+        {
+            auto result = EMPTY;
+            for(auto i = 0; i < count; ++i)
+            {
+                result |= A1 << random() % NumberOfSquares;
+            }
+            return result;
+        };
+        query.rooks = pieces(1 + random() % 4);
+        query.bishops = pieces(1 + random() % 4) & ~query.rooks;
+        query.occupied = (random() & random()) | query.rooks | query.bishops;
+    }
+
+    auto const available = detectSliderAttacks() == PEXT_ATTACKS 
+        ? std::vector<SliderAttacks> { PEXT_ATTACKS, MAGIC_ATTACKS, PORTABLE_ATTACKS }
+        : std::vector<SliderAttacks> { MAGIC_ATTACKS, PORTABLE_ATTACKS };
+
+    for(auto const attacks : available)
+    {
+        sliderAttacks = attacks;
+        for(auto const query : queries)
+        {
+            if(separateLookup(query) != packedLookup(query))
+            {
+                std::cout << sliderAttacksName(attacks) << " attacks differ on square " << query.square 
+                    << ", occupancy " << query.occupied << std::endl;
+                return 1;
+            }
+        }
+        for(auto const query : setQueries)
+        {
+            if(tableSetLookup(query) != koggeStoneSetLookup(query))
+            {
+                std::cout << sliderAttacksName(attacks) << " set attacks differ for rooks " << query.rooks 
+                    << ", bishops " << query.bishops << ", occupancy " << query.occupied << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    BitBoard checksum = 0;
+    std::cout << lookups << " queen lookups, best of " << repetitions << " runs" << std::endl;
+    print("separate rank/file/diagonal tables", nanosecondsPerLookup<Query, separateLookup>(queries, repetitions, checksum),
+        sizeof(RankAttacks) + sizeof(FileAttacks) + sizeof(DiagonalAttacks));
+
+    for(auto const attacks : available)
+    {
+        sliderAttacks = attacks;
+        auto const name = std::string("packed rook/bishop tables, ") + sliderAttacksName(attacks);
+        auto const size = attacks == MAGIC_ATTACKS ? sizeof(RookMagicAttacks) + sizeof(BishopMagicAttacks)
+            : sizeof(RookAttacks) + sizeof(BishopAttacks);
+        print(name.c_str(), nanosecondsPerLookup<Query, packedLookup>(queries, repetitions, checksum), size);
+    }
+
+    std::cout << lookups << " rook and bishop set lookups" << std::endl;
+    for(auto const attacks : available)
+    {
+        sliderAttacks = attacks;
+        auto const name = std::string("one lookup per piece, ") + sliderAttacksName(attacks);
+        print(name.c_str(), nanosecondsPerLookup<SetQuery, tableSetLookup>(setQueries, repetitions, checksum));
+    }
+#ifdef __AVX2__
+    print("set-wise Kogge-Stone, AVX2", 
+#else
+    print("set-wise, one lookup per piece", 
+#endif
+        nanosecondsPerLookup<SetQuery, koggeStoneSetLookup>(setQueries, repetitions, checksum));
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+}
@@ -0,0 +1,95 @@
+// Compares the two ways of taking moves back: XOR make/unmake (default) and copy-make
+// (COPY_MAKE in Position.hpp), and the two board representations (QUAD_BITBOARD in
+// PieceBitBoards.hpp). Build it once per combination, e.g.
+//
+//   clang++ -std=c++17 -O3 -march=native -pthread -I. [-DCOPY_MAKE] [-DQUAD_BITBOARD]
+//       benchmark/MakeUnmakeBenchmark.cpp BitBoard.cpp HashTable.cpp Mobility.cpp Move.cpp
+//       NeuralNetwork.cpp Position.cpp TimeManagement.cpp -o makeUnmakeBenchmark
+//
+// and compare the nodes per second. Node counts have to be identical for all combinations.
+//
+// usage: makeUnmakeBenchmark [search|perft] [depth] [repetitions] [auto|pext|magic|portable]
+
+#include "Position.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace spezi;
+
+namespace
+{
+    // positions outside the opening book, with castling, en passant, promotions and checks
+    char const * const BenchmarkPositions[] =
+    {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "rnbqkb1r/pp1p1ppp/4pn2/2pP4/2P5/8/PP2PPPP/RNBQKBNR w KQkq c6 0 4"
+    };
+
+#ifdef COPY_MAKE
+    auto constexpr Strategy = "copy-make";
+#else
+    auto constexpr Strategy = "XOR make/unmake";
+#endif
+
+#ifdef QUAD_BITBOARD
+    auto constexpr Representation = "quad bitboard";
+#else
+    auto constexpr Representation = "piece bitboards";
+#endif
+}
+
+int main(int const argc, char const * const argv[])
+{
+    auto const perft = argc > 1 && std::string(argv[1]) == "perft";
+    auto const depth = argc > 2 ? std::stoi(argv[2]) : (perft ? 4 : 3);
+    auto const repetitions = argc > 3 ? std::stoi(argv[3]) : 3;
+    sliderAttacks = parseSliderAttacks(argc > 4 ? argv[4] : "auto");
+
+    std::cout << Strategy << ", " << Representation << ", " << (perft ? "perft" : "search") << " to depth " << depth 
+        << ", best of " << repetitions << " runs, board state " << sizeof(BoardState) << " bytes, "
+        << sliderAttacksName(sliderAttacks) << " slider attacks" << std::endl;
+
+    EvaluationParameters parameters;
+    parameters.depth = depth;
+    parameters.perft = perft;
+
+    int64_t totalNodes = 0;
+    auto totalSeconds = 0.;
+
+    for(auto const fen : BenchmarkPositions)
+    {
+        Position position(fen, [](std::string){});
+        // keep the quiescence search from dominating the node counts
+        position.setMaxQuiescenceDepth(4);
+        EvaluationStatistics best {};
+        best.seconds = std::numeric_limits<float>::max();
+
+        for(auto repetition = 0; repetition < repetitions; ++repetition)
+        {
+            position.setFen(fen);
+            position.clearHashTable();
+            auto const statistics = position.evaluateRecursively(parameters);
+            if(statistics.seconds < best.seconds)
+            {
+                best = statistics;
+            }
+        }
+
+        totalNodes += best.numberOfNodes;
+        totalSeconds += best.seconds;
+
+        std::cout << std::setw(12) << best.numberOfNodes << " nodes " 
+            << std::setw(8) << std::fixed << std::setprecision(3) << best.seconds << " s  " << fen << std::endl;
+    }
+
+    std::cout << std::setw(12) << totalNodes << " nodes " 
+        << std::setw(8) << std::fixed << std::setprecision(3) << totalSeconds << " s  "
+        << static_cast<int64_t>(totalNodes / std::max(totalSeconds, 1e-3)) << " nodes per second" << std::endl;
+}
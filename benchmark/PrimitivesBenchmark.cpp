@@ -0,0 +1,319 @@
+// Times the hot primitives of the engine in isolation: the rook and bishop attack lookups (the
+// rank, file and diagonal tables packed into one table each, SliderAttacks backend as detected
+// at startup), isAttacked, evaluateStatically, HashTable::get and insert at several table sizes,
+// makeMove + unmakeMove and Move::getUciNotation. Inputs are random with fixed seeds: sparse
+// occupancies, hash keys and positions reached by random games from a few start positions.
+// Each primitive is timed in several samples, reported as the mean in ns per operation with a
+// 95% confidence interval and the fastest sample. Build it with e.g.
+//
+//   clang++ -std=c++17 -O3 -march=native -pthread -I. benchmark/PrimitivesBenchmark.cpp
+//       BitBoard.cpp HashTable.cpp Mobility.cpp Move.cpp NeuralNetwork.cpp Position.cpp
+//       TimeManagement.cpp -o primitivesBenchmark
+//
+// usage: primitivesBenchmark [samples] [--json]
+
+#include "Position.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace spezi;
+
+namespace
+{
+    char const * const StartPositions[] =
+    {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10"
+    };
+
+    auto constexpr NumberOfPositions = 256;
+    auto constexpr NumberOfQueries = 1 << 20;
+
+    // results are summed up here to keep the compiler from dropping the timed calls
+    uint64_t checksum = 0;
+
+    using Seconds = std::chrono::duration<double>;
+
+    struct Result
+    {
+        std::string name;
+        int64_t operations;
+        double mean;
+        double confidence;
+        double fastest;
+    };
+
+    // runs one sample: calls the primitive on all inputs, returns the operations and the timed seconds
+    template<typename Sample>
+    Result measure(std::string name, int const samples, Sample sample)
+    {
+        std::vector<double> nanoseconds;
+        int64_t operations = 0;
+        sample(operations);     // warm up caches and branch predictors
+
+        for(auto i = 0; i < samples; ++i)
+        {
+            operations = 0;
+            auto const seconds = sample(operations);
+            nanoseconds.push_back(seconds * 1e9 / operations);
+        }
+
+        auto const mean = std::accumulate(nanoseconds.begin(), nanoseconds.end(), 0.) / samples;
+        auto variance = 0.;
+        for(auto const value : nanoseconds)
+        {
+            variance += (value - mean) * (value - mean);
+        }
+        variance /= std::max(samples - 1, 1);
+
+        return Result {std::move(name), operations, mean, 1.96 * std::sqrt(variance / samples),
+            *std::min_element(nanoseconds.begin(), nanoseconds.end())};
+    }
+
+    // positions after 0 to 59 random plies, games ending in mate or stalemate are started over
+    std::vector<std::string> randomPositions(Position & position)
+    {
+        std::mt19937_64 random(20240102);
+        std::vector<std::string> fens;
+        while(fens.size() < NumberOfPositions)
+        {
+            position.setFen(StartPositions[random() % std::size(StartPositions)]);
+            auto const plies = random() % 60;
+            for(unsigned int ply = 0; ply <= plies; ++ply)
+            {
+                auto const moves = position.legalMoves();
+                if(moves.empty())
+                {
+                    break;
+                }
+                if(ply == plies)
+                {
+                    fens.push_back(position.getFen());
+                    break;
+                }
+                position.makeMove(moves[random() % moves.size()].getUciNotation());
+            }
+        }
+        return fens;
+    }
+
+    void printText(std::vector<Result> const & results, int const samples)
+    {
+        std::cout << "ns per operation, mean of " << samples << " samples with 95% confidence interval" << std::endl;
+        for(auto const & result : results)
+        {
+            std::cout << std::left << std::setw(28) << result.name << std::right << std::fixed << std::setprecision(2)
+                << std::setw(10) << result.mean << " +- " << std::setw(6) << result.confidence
+                << "  (fastest " << result.fastest << ", " << result.operations << " operations)" << std::endl;
+        }
+    }
+
+    void printJson(std::vector<Result> const & results, int const samples)
+    {
+        std::cout << "{\"samples\": " << samples << ", \"results\": [" << std::endl;
+        for(size_t i = 0; i < results.size(); ++i)
+        {
+            auto const & result = results[i];
+            std::cout << std::fixed << std::setprecision(3)
+                << "  {\"name\": \"" << result.name << "\", \"operations\": " << result.operations
+                << ", \"ns_per_op\": " << result.mean << ", \"ci95\": " << result.confidence
+                << ", \"fastest\": " << result.fastest << "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+        }
+        std::cout << "]}" << std::endl;
+    }
+}
+
+int main(int const argc, char const * const argv[])
+{
+    auto samples = 10;
+    auto json = false;
+    for(auto i = 1; i < argc; ++i)
+    {
+        if(std::string(argv[i]) == "--json")
+        {
+            json = true;
+        }
+        else
+        {
+            samples = std::max(std::stoi(argv[i]), 2);
+        }
+    }
+
+    std::vector<Result> results;
+
+    // sparse occupancies like in middle games
+    struct Query
+    {
+        Square square;
+        BitBoard occupied;
+    };
+    std::mt19937_64 random(20240101);
+    std::vector<Query> queries(NumberOfQueries);
+    for(auto & query : queries)
+    {
+        query.square = random() % NumberOfSquares;
+        query.occupied = random() & random() & ~(A1 << query.square);
+    }
+
+    auto const timeAttacks = [&queries](BitBoard attacks(Square, BitBoard))
+    {
+        return [&queries, attacks](int64_t & operations)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            for(auto const query : queries)
+            {
+                checksum += attacks(query.square, query.occupied);
+            }
+            operations += queries.size();
+            return Seconds(std::chrono::steady_clock::now() - start).count();
+        };
+    };
+    results.push_back(measure(std::string("rookAttacks, ") + sliderAttacksName(sliderAttacks), samples, timeAttacks(rookAttacks)));
+    results.push_back(measure(std::string("bishopAttacks, ") + sliderAttacksName(sliderAttacks), samples, timeAttacks(bishopAttacks)));
+
+    // the position primitives are timed per position, leaving out setFen
+    Position position(STARTING_FEN, [](std::string){});
+    auto const fens = randomPositions(position);
+
+    results.push_back(measure("isAttacked", samples, [&position, &fens](int64_t & operations)
+    {
+        auto seconds = 0.;
+        for(auto const & fen : fens)
+        {
+            position.setFen(fen);
+            auto const start = std::chrono::steady_clock::now();
+            for(Square square = 0; square < NumberOfSquares; ++square)
+            {
+                checksum += position.isAttacked(WHITE, square);
+                checksum += position.isAttacked(BLACK, square);
+            }
+            seconds += Seconds(std::chrono::steady_clock::now() - start).count();
+            operations += 2 * NumberOfSquares;
+        }
+        return seconds;
+    }));
+
+    results.push_back(measure("evaluateStatically", samples, [&position, &fens](int64_t & operations)
+    {
+        auto constexpr repetitions = 64;
+        auto seconds = 0.;
+        for(auto const & fen : fens)
+        {
+            position.setFen(fen);
+            auto const start = std::chrono::steady_clock::now();
+            for(auto i = 0; i < repetitions; ++i)
+            {
+                checksum += position.evaluateStatically();
+            }
+            seconds += Seconds(std::chrono::steady_clock::now() - start).count();
+            operations += repetitions;
+        }
+        return seconds;
+    }));
+
+    std::vector<std::vector<Move>> movesPerPosition;
+    for(auto const & fen : fens)
+    {
+        position.setFen(fen);
+        movesPerPosition.push_back(position.legalMoves());
+    }
+
+    results.push_back(measure("makeMove + unmakeMove", samples, [&position, &fens, &movesPerPosition](int64_t & operations)
+    {
+        auto constexpr repetitions = 16;
+        auto seconds = 0.;
+        for(size_t i = 0; i < fens.size(); ++i)
+        {
+            position.setFen(fens[i]);
+            auto const start = std::chrono::steady_clock::now();
+            for(auto repetition = 0; repetition < repetitions; ++repetition)
+            {
+                for(auto const move : movesPerPosition[i])
+                {
+                    UndoState undoState;
+                    position.makeMove(move, undoState);
+                    position.unmakeMove(move, undoState);
+                }
+            }
+            seconds += Seconds(std::chrono::steady_clock::now() - start).count();
+            operations += repetitions * movesPerPosition[i].size();
+        }
+        return seconds;
+    }));
+
+    std::vector<Move> allMoves;
+    for(auto const & moves : movesPerPosition)
+    {
+        allMoves.insert(allMoves.end(), moves.begin(), moves.end());
+    }
+
+    results.push_back(measure("Move::getUciNotation", samples, [&allMoves](int64_t & operations)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        for(auto const move : allMoves)
+        {
+            checksum += move.getUciNotation().size();
+        }
+        operations += allMoves.size();
+        return Seconds(std::chrono::steady_clock::now() - start).count();
+    }));
+
+    // random keys, drafts and entry types; the tables are filled before get is timed
+    std::vector<HashEntry> entries;
+    for(auto i = 0; i < NumberOfQueries; ++i)
+    {
+        entries.emplace_back(static_cast<HashEntryType>(random() % 3), random(), static_cast<int>(random() % 32),
+            static_cast<MilliSquare>(random() % 2000) - 1000);
+    }
+
+    for(auto const megaBytes : {1, 16, 256})
+    {
+        HashTable table(static_cast<size_t>(megaBytes) << 20);
+        auto const size = std::to_string(megaBytes) + " MB";
+
+        results.push_back(measure("HashTable::insert, " + size, samples, [&table, &entries](int64_t & operations)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            for(auto const & entry : entries)
+            {
+                checksum += table.insert(entry);
+            }
+            operations += entries.size();
+            return Seconds(std::chrono::steady_clock::now() - start).count();
+        }));
+
+        results.push_back(measure("HashTable::get, " + size, samples, [&table, &entries](int64_t & operations)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            for(auto const & entry : entries)
+            {
+                checksum += table.get(entry.zKey).zKey;
+            }
+            operations += entries.size();
+            return Seconds(std::chrono::steady_clock::now() - start).count();
+        }));
+    }
+
+    if(json)
+    {
+        printJson(results, samples);
+    }
+    else
+    {
+        printText(results, samples);
+        std::cout << "(checksum " << checksum << ")" << std::endl;
+    }
+}
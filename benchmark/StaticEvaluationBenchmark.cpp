@@ -0,0 +1,141 @@
+// Times evaluateStatically() on random boards with 3 to 32 pieces, to compare the layouts of
+// the static mobility tables (population-major 16 bit slabs against the former int tables
+// indexed [square][population]). It uses the public interface of Position only, so build it
+// at both revisions with the sources of the engine except spezi.cpp, e.g.
+//
+//   clang++ -std=c++17 -O3 -march=native -pthread -I. benchmark/StaticEvaluationBenchmark.cpp
+//       BitBoard.cpp HashTable.cpp Mobility.cpp Move.cpp NeuralNetwork.cpp Position.cpp
+//       TimeManagement.cpp -o staticEvaluationBenchmark
+//
+// and compare the ns per evaluation. Checksums have to be identical for both revisions.
+// The second run streams through some unrelated memory between evaluations (included in the
+// time), which evicts the tables from L1 like the rest of a search does.
+//
+// usage: staticEvaluationBenchmark [boards] [repetitions] [traffic KB]
+
+#include "Position.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace spezi;
+
+namespace
+{
+    // evaluations per board and run, the board is set up outside the timed loop
+    auto constexpr EvaluationsPerBoard = 16;
+
+    // two kings and up to 30 other pieces on random squares, no pawns on the first or last rank
+    std::string randomBoard(std::mt19937_64 & random, int const population)
+    {
+        std::string board(NumberOfSquares, ' ');
+        auto const place = [&board, &random](char const piece)
+        {
+            auto square = 0;
+            do
+            {
+                square = random() % NumberOfSquares;
+            }
+            while(board[square] != ' '
+                || ((piece == 'P' || piece == 'p') && (square < SquaresPerRank || square >= NumberOfSquares - SquaresPerRank)));
+            board[square] = piece;
+        };
+
+        place('K');
+        place('k');
+        for(auto i = 2; i < population; ++i)
+        {
+            auto const piece = "PNBRQ"[random() % 5];
+            place(i % 2 ? static_cast<char>(piece - 'A' + 'a') : piece);
+        }
+
+        std::string fen;
+        for(auto rank = SquaresPerFile - 1; rank >= 0; --rank)
+        {
+            auto emptySquares = 0;
+            for(auto file = 0; file < SquaresPerRank; ++file)
+            {
+                auto const piece = board[rank * SquaresPerRank + file];
+                if(piece == ' ')
+                {
+                    ++emptySquares;
+                    continue;
+                }
+                if(emptySquares)
+                {
+                    fen += std::to_string(emptySquares);
+                    emptySquares = 0;
+                }
+                fen += piece;
+            }
+            if(emptySquares)
+            {
+                fen += std::to_string(emptySquares);
+            }
+            fen += rank ? "/" : " w - - 0 1";
+        }
+        return fen;
+    }
+}
+
+int main(int const argc, char const * const argv[])
+{
+    auto const numberOfBoards = argc > 1 ? std::stoi(argv[1]) : 4096;
+    auto const repetitions = argc > 2 ? std::stoi(argv[2]) : 3;
+    auto const trafficKiloBytes = argc > 3 ? std::stoi(argv[3]) : 32;
+
+    std::mt19937_64 random(20240103);
+    std::vector<std::string> fens;
+    for(auto i = 0; i < numberOfBoards; ++i)
+    {
+        fens.push_back(randomBoard(random, 3 + random() % 30));
+    }
+
+    Position position(STARTING_FEN, [](std::string){});
+    std::vector<uint64_t> traffic(trafficKiloBytes * 1024 / sizeof(uint64_t) + 1, 1);
+    uint64_t trafficSum = 0;
+
+    std::cout << numberOfBoards << " random boards, " << EvaluationsPerBoard << " evaluations each, best of "
+        << repetitions << " runs" << std::endl;
+
+    for(auto const kiloBytes : {0, trafficKiloBytes})
+    {
+        auto best = std::numeric_limits<double>::max();
+        int64_t checksum = 0;
+
+        for(auto repetition = 0; repetition < repetitions; ++repetition)
+        {
+            auto seconds = 0.;
+            checksum = 0;
+            for(auto const & fen : fens)
+            {
+                position.setFen(fen);
+                auto const start = std::chrono::steady_clock::now();
+                for(auto i = 0; i < EvaluationsPerBoard; ++i)
+                {
+                    checksum += position.evaluateStatically();
+                    // one access per cache line
+                    for(size_t j = 0; j < static_cast<size_t>(kiloBytes) * 1024 / sizeof(uint64_t); j += 8)
+                    {
+                        trafficSum += traffic[j]++;
+                    }
+                }
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            best = std::min(best, seconds);
+        }
+
+        std::cout << "evaluateStatically, " << std::setw(4) << kiloBytes << " KB traffic: " << std::fixed
+            << std::setprecision(1) << best * 1e9 / (static_cast<double>(numberOfBoards) * EvaluationsPerBoard)
+            << " ns per evaluation (checksum " << checksum << ")" << std::endl;
+    }
+
+    std::cout << "(traffic checksum " << trafficSum << ")" << std::endl;
+}
@@ -1,9 +1,30 @@
 #include "UCI.hpp"
 
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 using namespace spezi;
 
-int main()
+int main(int const argc, char const * const argv[])
 {
+    // spezi bench [depth] [threads] [hash]
+    if(argc > 1 && std::string(argv[1]) == "bench")
+    {
+        try
+        {
+            std::vector<std::string> const args(argv + 2, argv + argc);
+            UCI::bench(args.cbegin(), args.cend());
+            return 0;
+        }
+        catch(std::exception const & e)
+        {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+    }
+
     UCI uci;
     uci.run();
 }